@@ -0,0 +1,234 @@
+/*
+    dotsfbench, the benchmark runner for EXDotSF.
+    Runs every program in bench/ (or the ones given) under one or two exdotsf binaries and reports the median wall time,
+    instructions per second and peak RSS of each, e.g.
+
+        dotsfbench ./exdotsf
+        dotsfbench -r 11 "./exdotsf --jit" "/tmp/old/exdotsf" bench/arith.dsf
+
+    A binary may carry its own options after a space. When a program foo.dsf has a foo.in next to it, that is its stdin,
+    otherwise stdin is /dev/null. Output always goes to /dev/null.
+    The instruction count comes from one --profile run, so it counts the program as written (before any fusing) and stays
+    the same whichever binary or engine is measured, which keeps instructions/sec comparable between them.
+    Runs of the two binaries alternate A B B A ... so drift (thermal, other load) hits both the same.
+
+    Same license as exdotsf.c.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define BENCH_MAX_ARGS 32
+#define BENCH_MAX_REPS 1000
+
+typedef struct bench_binary
+{
+    const char* spec;
+    char* argv[BENCH_MAX_ARGS+2];
+    int argc;
+} bench_binary;
+typedef struct bench_result
+{
+    double times[BENCH_MAX_REPS];
+    long maxrss; //KiB.
+    int status; //exit status of the first run, -1 if it didn't exit normally.
+    bool mixed; //a later run exited differently.
+} bench_result;
+
+bool bench_split(bench_binary* bin, const char* spec) //splits "path opt opt" into an argv with room for the program path at the end.
+{
+    char* copy = strdup(spec);
+    bin->spec = spec;
+    bin->argc = 0;
+    for (char* tok = strtok(copy, " \t"); tok != NULL; tok = strtok(NULL, " \t"))
+    {
+        if (bin->argc >= BENCH_MAX_ARGS){return false;}
+        bin->argv[bin->argc++] = tok;
+    }
+    return bin->argc > 0;
+}
+double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec+ts.tv_nsec/1e9;
+}
+pid_t bench_spawn(bench_binary* bin, const char* const* extra, const char* prog, const char* input, int errfd) //starts bin [extra...] prog, stderr to errfd (-1 for /dev/null).
+{
+    char* argv[BENCH_MAX_ARGS+4];
+    int argc = 0;
+    for (int i = 0; i < bin->argc; i++){argv[argc++] = bin->argv[i];}
+    for (; extra != NULL && *extra != NULL; extra++){argv[argc++] = (char*)*extra;}
+    argv[argc++] = (char*)prog;
+    argv[argc] = NULL;
+    pid_t pid = fork();
+    if (pid != 0){return pid;}
+    int in = open((input != NULL) ? (input) : ("/dev/null"), O_RDONLY), null = open("/dev/null", O_WRONLY);
+    if (in < 0 || null < 0){_exit(127);}
+    dup2(in, STDIN_FILENO);
+    dup2(null, STDOUT_FILENO);
+    dup2((errfd >= 0) ? (errfd) : (null), STDERR_FILENO);
+    execvp(argv[0], argv);
+    _exit(127);
+}
+bool bench_run(bench_binary* bin, const char* prog, const char* input, bench_result* res, int rep) //one timed run, rep < 0 for a warmup.
+{
+    struct rusage ru;
+    int status;
+    double start = bench_now();
+    pid_t pid = bench_spawn(bin, NULL, prog, input, -1);
+    if (pid < 0 || wait4(pid, &status, 0, &ru) < 0){return false;}
+    double took = bench_now()-start;
+    int code = (WIFEXITED(status)) ? (WEXITSTATUS(status)) : (-1);
+    if (code == 127){return false;} //the binary could not be started.
+    if (rep < 0){return true;}
+    res->times[rep] = took;
+    if (rep == 0){res->status = code; res->maxrss = 0; res->mixed = false;}
+    else if (code != res->status){res->mixed = true;}
+    if (ru.ru_maxrss > res->maxrss){res->maxrss = ru.ru_maxrss;}
+    return true;
+}
+uint64_t bench_count(bench_binary* bin, const char* prog, const char* input) //instructions executed according to --profile, 0 if bin has no profiler.
+{
+    static const char* const profile[] = {"--profile", NULL};
+    char report[4096];
+    int fds[2], status;
+    uint64_t count = 0;
+    if (pipe(fds) != 0){return 0;}
+    pid_t pid = bench_spawn(bin, profile, prog, input, fds[1]);
+    close(fds[1]);
+    FILE* in = fdopen(fds[0], "r");
+    while (fgets(report, sizeof(report), in) != NULL)
+    {
+        if (count == 0 && sscanf(report, "%" SCNu64 " instructions in", &count) != 1){count = 0;}
+    }
+    fclose(in);
+    if (pid > 0){waitpid(pid, &status, 0);}
+    return count;
+}
+int bench_cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+double bench_median(bench_result* res, int reps)
+{
+    qsort(res->times, reps, sizeof(double), bench_cmp_double);
+    return (reps%2) ? (res->times[reps/2]) : ((res->times[reps/2-1]+res->times[reps/2])/2);
+}
+int bench_cmp_str(const void* a, const void* b)
+{
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+int bench_list(const char* dir, char*** out) //every *.dsf in dir, sorted.
+{
+    DIR* d = opendir(dir);
+    struct dirent* ent;
+    int n = 0, cap = 16;
+    char** names = malloc(sizeof(char*)*cap);
+    if (d == NULL){return -1;}
+    while ((ent = readdir(d)) != NULL)
+    {
+        size_t len = strlen(ent->d_name);
+        if (len < 5 || strcmp(ent->d_name+len-4, ".dsf") != 0){continue;}
+        if (n == cap){names = realloc(names, sizeof(char*)*(cap *= 2));}
+        names[n] = malloc(strlen(dir)+len+2);
+        sprintf(names[n++], "%s/%s", dir, ent->d_name);
+    }
+    closedir(d);
+    qsort(names, n, sizeof(char*), bench_cmp_str);
+    *out = names;
+    return n;
+}
+void bench_usage(const char* self)
+{
+    fprintf(stderr, "usage: %s [-w warmups] [-r runs] [-d dir] \"exdotsf [options]\" [\"other exdotsf [options]\"] [program.dsf ...]\n", self);
+}
+int main(int argc, char** argv)
+{
+    bench_binary bins[2];
+    int nbins = 0, warmups = 2, reps = 7, nprogs = 0;
+    const char* dir = "bench";
+    char** progs = malloc(sizeof(char*)*argc);
+    for (int i = 1; i < argc; i++)
+    {
+        size_t len = strlen(argv[i]);
+        if (len == 0){continue;} //lets `make bench BASELINE=` pass an empty second binary.
+        else if ((!strcmp(argv[i], "-w") || !strcmp(argv[i], "-r") || !strcmp(argv[i], "-d")) && i+1 < argc)
+        {
+            if (argv[i][1] == 'd'){dir = argv[++i];}
+            else if (argv[i][1] == 'w'){warmups = atoi(argv[++i]);}
+            else {reps = atoi(argv[++i]);}
+        }
+        else if (argv[i][0] == '-'){bench_usage(argv[0]); return 1;}
+        else if (len > 4 && !strcmp(argv[i]+len-4, ".dsf")){progs[nprogs++] = argv[i];}
+        else if (nbins == 2 || !bench_split(bins+nbins, argv[i])){bench_usage(argv[0]); return 1;}
+        else {nbins++;}
+    }
+    if (nbins == 0 || reps < 1 || reps > BENCH_MAX_REPS || warmups < 0){bench_usage(argv[0]); return 1;}
+    if (nprogs == 0 && (nprogs = bench_list(dir, &progs)) <= 0){fprintf(stderr, "no programs found in %s\n", dir); return 1;}
+    for (int b = 0; b < nbins; b++){printf("%c: %s\n", 'A'+b, bins[b].spec);}
+    printf("%i warmup and %i timed runs per binary, median wall time shown\n\n", warmups, reps);
+    printf("%-16s %14s", "program", "instructions");
+    for (int b = 0; b < nbins; b++){printf("  %c %8s %10s %9s", 'A'+b, "time", "Minsn/s", "peak RSS");}
+    printf((nbins == 2) ? ("  %8s\n") : ("\n"), "B/A time");
+    bench_result* results = malloc(sizeof(bench_result)*2);
+    int failures = 0;
+    for (int p = 0; p < nprogs; p++)
+    {
+        char* input = malloc(strlen(progs[p])+1);
+        strcpy(input, progs[p]);
+        strcpy(input+strlen(input)-4, ".in");
+        if (access(input, R_OK) != 0){free(input); input = NULL;}
+        const char* name = strrchr(progs[p], '/');
+        name = (name != NULL) ? (name+1) : (progs[p]);
+        uint64_t count = 0;
+        for (int b = 0; b < nbins && count == 0; b++){count = bench_count(bins+b, progs[p], input);}
+        bool ok = true;
+        for (int r = -warmups; r < reps && ok; r++)
+        {
+            for (int k = 0; k < nbins && ok; k++)
+            {
+                int b = ((r+warmups)%2) ? (nbins-1-k) : (k);
+                ok = bench_run(bins+b, progs[p], input, results+b, r);
+            }
+        }
+        free(input);
+        if (!ok){printf("%-16s could not run\n", name); failures++; continue;}
+        printf("%-16s ", name);
+        if (count > 0){printf("%14" PRIu64, count);}
+        else {printf("%14s", "-");}
+        double medians[2];
+        for (int b = 0; b < nbins; b++)
+        {
+            medians[b] = bench_median(results+b, reps);
+            printf("  %c %7.3fs", 'A'+b, medians[b]);
+            if (count > 0){printf(" %10.1f", count/medians[b]/1e6);}
+            else {printf(" %10s", "-");}
+            printf(" %7.1fM", results[b].maxrss/1024.0);
+        }
+        if (nbins == 2){printf("  %7.2fx", medians[1]/medians[0]);}
+        printf("\n");
+        for (int b = 0; b < nbins; b++)
+        {
+            if (results[b].mixed){printf("    %c: exit status changed between runs\n", 'A'+b);}
+        }
+        if (nbins == 2 && results[0].status != results[1].status)
+        {
+            printf("    A exited with %i but B with %i\n", results[0].status, results[1].status);
+        }
+    }
+    free(results);
+    return (failures > 0) ? (1) : (0);
+}
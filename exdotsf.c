@@ -43,28 +43,211 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdlib.h>
 #include <ctype.h>
 #include <time.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+#include "exdotsf.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define DOTSF_HAVE_MMAP 1
+#else
+#define DOTSF_HAVE_MMAP 0
+#endif
 #define DOTSF_MAX_STACKS 10
 #define DOTSF_MAX_STACK_SIZE 30000
 #define DOTSF_MAX_HASHOP_VAL_SIZE 65
-typedef int dotsf_int;
+#define DOTSF_LOOP_MAX_SLOTS 64 //the most elements a loop collapsed by dotsf_optimize may work on.
+#define DOTSF_LOOP_MAX_BODY 1024 //the longest loop body dotsf_optimize tries to collapse.
+#define DOTSF_PREEVAL_STEPS 100000000 //how far --preeval runs a program that does no I/O, unless told otherwise.
+#define DOTSF_OUT_BUF_SIZE 65536
+#define DOTSF_IN_BUF_SIZE 65536
+#if defined(__GNUC__) && !defined(DOTSF_NO_THREADED) //labels as values are a GCC/Clang extension.
+#define DOTSF_HAVE_THREADED 1
+#else
+#define DOTSF_HAVE_THREADED 0
+#endif
+#if defined(__AVX2__) && !defined(DOTSF_NO_SIMD) //the source scanner, build with -mavx2 (or -march=native) for 32 bytes at a time.
+#include <immintrin.h>
+#define DOTSF_SIMD_WIDTH 32
+#elif defined(__SSE2__) && !defined(DOTSF_NO_SIMD)
+#include <emmintrin.h>
+#define DOTSF_SIMD_WIDTH 16
+#else
+#define DOTSF_SIMD_WIDTH 0
+#endif
+#ifndef DOTSF_NO_PROFILE //leaves --profile out, and with it the I/O timing checks.
+#define DOTSF_HAVE_PROFILE 1
+#else
+#define DOTSF_HAVE_PROFILE 0
+#endif
+#ifndef DOTSF_NO_TRACE //leaves --trace out.
+#define DOTSF_HAVE_TRACE 1
+#else
+#define DOTSF_HAVE_TRACE 0
+#endif
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(DOTSF_NO_BATCH) //leaves --batch out, and with it pthreads.
+#include <pthread.h>
+#define DOTSF_HAVE_BATCH 1
+#else
+#define DOTSF_HAVE_BATCH 0
+#endif
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(DOTSF_NO_SERVE) //leaves --serve out.
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#define DOTSF_HAVE_SERVE 1
+#else
+#define DOTSF_HAVE_SERVE 0
+#endif
+#if defined(__x86_64__) && DOTSF_HAVE_MMAP && !defined(DOTSF_NO_JIT) //the JIT emits System V x86-64 code.
+#define DOTSF_HAVE_JIT 1
+#else
+#define DOTSF_HAVE_JIT 0
+#endif
 typedef struct {
     bool in_use;
-    dotsf_int *stack, stacktop, maxstack;
+    dotsf_int *stack, head, count, cap, maxstack; //a circular buffer of cap elements that grows up to maxstack, the bottom element lives at stack[head].
 } dotsf_stack;
 typedef struct {
+    dotsf_int* stack;
+    dotsf_int cap;
+} dotsf_spare; //the buffer of a deleted stack, kept for the next one that gets created.
+typedef struct {
+    char buf[DOTSF_OUT_BUF_SIZE];
+    size_t len;
+    bool linebuffered; //flush after every newline instead of only when full.
+} dotsf_outbuf;
+typedef struct {
+    const unsigned char* data; //own, or the whole of stdin once _dotsf_map_stdin has mapped it.
+    size_t pos, len;
+    bool mapped;
+    unsigned char own[DOTSF_IN_BUF_SIZE];
+} dotsf_inbuf;
+typedef struct {
+    uint64_t *counts, *jumps; //how many times each instruction ran, and how many of those runs jumped.
+    dotsf_int highwater[DOTSF_MAX_STACKS]; //the deepest each stack got.
+    uint64_t iotime, iocalls; //nanoseconds spent in read(2) and write(2) and how many calls that took.
+} dotsf_profile;
+typedef struct {
+    uint32_t pc, srcoff; //the instruction about to run and the offset in the source it came from.
+    int32_t top; //the top of the current stack before it ran, 0 when that was empty.
+    uint8_t op, stack, empty, pad;
+} dotsf_trace_entry;
+typedef struct {
+    dotsf_trace_entry* ring; //a power of two entries, the step numbered n goes in ring[n & mask].
+    uint64_t mask;
+    /*
+        How many steps were recorded in all. Only counted once the entry is complete, and ring[steps & mask] (the oldest)
+        is the one being overwritten next, so a SIGUSR1 that lands in the middle of a step writes out the mask entries before it.
+    */
+    volatile uint64_t steps;
+} dotsf_trace;
+typedef struct {
+    uint64_t steps; //how many more instructions may run.
+    size_t pc; //the one it stopped in front of.
+} dotsf_prefix;
+struct dotsf_interpreter {
     dotsf_stack stacks[DOTSF_MAX_STACKS];
     unsigned int curstack;
-} dotsf_interpreter;
+    dotsf_spare spares[DOTSF_MAX_STACKS];
+    unsigned int nspares;
+    dotsf_engine engine;
+    dotsf_io io;
+    dotsf_outbuf out;
+    dotsf_inbuf in;
+    dotsf_profile* profile; //counters for the profiling engine, NULL when not profiling.
+    dotsf_trace* trace; //ring buffer for the tracing engine, NULL when not tracing.
+    dotsf_prefix* prefix; //where the prefix engine stops, only set while _dotsf_preeval runs it.
+};
+//every instruction a program can be compiled into, see dotsf_compile for the characters they come from and dotsf_optimize for the ones from ADDK on.
+#define DOTSF_OPCODES(X) \
+    X(END) X(FAIL) X(JMP) X(PUSHD) X(PUSHC) X(PUSHN) X(IFZ) X(PRINTI) X(PRINTC) \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(EQ) X(GT) X(LT) X(AND) X(LE) X(GE) \
+    X(READI) X(READC) X(DUP) X(DUP2) X(IF) X(ELSE) X(READL) X(ROT) X(DUMP) \
+    X(GCS) X(NS) X(DS) X(TFA) X(TFB) X(TFC) X(TFD) X(TFE) X(TFF) X(TFG) X(TFH) X(CS) X(CLR) \
+    X(MVN) X(CPN) X(MVA) X(CPA) X(REV) X(FILL) \
+    X(ADDK) X(SUBK) X(MULK) X(DIVK) X(MODK) X(EQK) X(GTK) X(LTK) X(ANDK) X(LEK) X(GEK) \
+    X(PUSHF) X(PRINTCK) X(PRINTIK) X(DUPJZ) X(DJEQK) X(DJGTK) X(DJLTK) X(DJANDK) X(DJLEK) X(DJGEK) X(GUARD) \
+    X(LOOP) X(LSLOT) X(DRAIN) X(XFER)
+typedef enum {
+    #define _DOTSF_OPENUM(name) DOTSF_OP_##name,
+    DOTSF_OPCODES(_DOTSF_OPENUM)
+    #undef _DOTSF_OPENUM
+    DOTSF_OP_COUNT
+} dotsf_opcode;
+static const char* const _dotsf_opnames[DOTSF_OP_COUNT] = {
+    #define _DOTSF_OPNAME(name) #name,
+    DOTSF_OPCODES(_DOTSF_OPNAME)
+    #undef _DOTSF_OPNAME
+};
+typedef struct {
+    uint8_t op;
+    int8_t err; //what a superinstruction returns when the push it stands in for fails.
+    uint16_t len; //how many of the instructions after a GUARD it covers.
+    dotsf_int arg, arg2; //immediate value, jump target or error status depending on op, arg2 is only used by superinstructions.
+} dotsf_insn;
+typedef struct {
+    uint32_t start, curstack; //the instruction runs resume at and the stack they are on there.
+    dotsf_int inuse[DOTSF_MAX_STACKS], maxstack[DOTSF_MAX_STACKS], count[DOTSF_MAX_STACKS];
+    dotsf_int data[]; //the elements of every stack in use, bottom first, stack 0's before stack 1's and so on.
+} dotsf_snapshot; //what the program's input independent prefix left behind, see _dotsf_preeval.
+struct dotsf_program {
+    dotsf_insn* code;
+    uint32_t* srcmap; //source offset of each instruction.
+    size_t len, cap, erroff; //erroff is the source offset dotsf_compile failed at.
+    int (*jitentry)(dotsf_interpreter* interp, const dotsf_program* prog); //set by dotsf_jit_compile.
+    void* jitcode;
+    size_t jitsize;
+    void* map; //the --cache file code and srcmap point into, NULL when they were malloced.
+    size_t mapsize;
+    dotsf_snapshot* snap; //where every run starts instead of an empty stack 0 at the first instruction, NULL for that.
+    size_t snapsize;
+};
+dotsf_int* _dotsf_slot(dotsf_stack* stack, dotsf_int i) //the i-th element counting up from the bottom.
+{
+    size_t idx = (size_t)stack->head+i;
+    if (idx >= (size_t)stack->cap){idx -= stack->cap;}
+    return stack->stack+idx;
+}
+bool _dotsf_reserve(dotsf_stack* stack, dotsf_int need) //makes room for need more elements, false if that would pass maxstack or memory runs out.
+{
+    if (need > stack->maxstack-stack->count){return false;}
+    if (need <= stack->cap-stack->count){return true;}
+    //grow geometrically so a stack only ever takes memory in proportion to how deep it has actually been.
+    dotsf_int oldcap = stack->cap, newcap = (oldcap < 16) ? (16) : (oldcap);
+    while (newcap-stack->count < need && newcap < stack->maxstack){newcap = (newcap > stack->maxstack/2) ? (stack->maxstack) : (newcap*2);}
+    if (newcap > stack->maxstack){newcap = stack->maxstack;}
+    dotsf_int* grown = realloc(stack->stack, sizeof(dotsf_int)*newcap);
+    if (grown == NULL){return false;}
+    if (stack->head+stack->count > oldcap) //the elements wrapped around, slide the run that starts at head up to the new end.
+    {
+        dotsf_int run = oldcap-stack->head;
+        memmove(grown+newcap-run, grown+stack->head, sizeof(dotsf_int)*run);
+        stack->head = newcap-run;
+    }
+    stack->stack = grown;
+    stack->cap = newcap;
+    return true;
+}
 bool _dotsf_push_to_stack(dotsf_interpreter* interp, dotsf_int stacknum, dotsf_int value)
 {
     if (stacknum < 0 || stacknum >= DOTSF_MAX_STACKS){return false;}
     dotsf_stack* stack = interp->stacks+stacknum;
     if (!stack->in_use){return false;}
-    if (stack->stacktop < 0){stack->stack[0] = value; stack->stacktop = 0; return true;}
-    else if (stack->stacktop >= 0 && stack->stacktop <= stack->maxstack){stack->stack[++(stack->stacktop)] = value; return true;} 
-    return false;   
+    if (stack->count >= stack->cap && !_dotsf_reserve(stack, 1)){return false;}
+    *_dotsf_slot(stack, (stack->count)++) = value;
+    return true;
 }
 bool _dotsf_push(dotsf_interpreter* interp, dotsf_int value)
 {
@@ -75,7 +258,7 @@ bool _dotsf_pop_from_stack(dotsf_interpreter* interp, dotsf_int stacknum, dotsf_
     if (stacknum < 0 || stacknum >= DOTSF_MAX_STACKS){return false;}
     dotsf_stack* stack = interp->stacks+stacknum;
     if (!stack->in_use){return false;}
-    if (stack->stacktop >= 0){*ret = stack->stack[(stack->stacktop)--]; return true;}
+    if (stack->count > 0){*ret = *_dotsf_slot(stack, --(stack->count)); return true;}
     return false;
 }
 bool _dotsf_pop(dotsf_interpreter* interp, dotsf_int* ret)
@@ -86,35 +269,106 @@ bool _dotsf_popbottom(dotsf_interpreter* interp, dotsf_int stacknum, dotsf_int*
 {
     if (stacknum < 0 || stacknum >= DOTSF_MAX_STACKS){return false;}
     dotsf_stack* stack = interp->stacks+stacknum;
-    if (stack->stacktop >= 0)
+    if (stack->count > 0)
     {
-        *ret = stack->stack[0];
-        for (dotsf_int i = 1; i <= stack->stacktop; i++){stack->stack[i-1] = stack->stack[i];} stack->stacktop--;
+        *ret = stack->stack[stack->head];
+        if (++(stack->head) == stack->cap){stack->head = 0;}
+        stack->count--;
         return true;
     }
     return false;
 }
 bool _dotsf_popb_pusht(dotsf_interpreter* interp, dotsf_int stacknum)
 {
-    dotsf_int v;
-    if (!_dotsf_popbottom(interp, stacknum, &v)){return false;}
-    if (!_dotsf_push_to_stack(interp, stacknum, v)){return false;}
+    if (stacknum < 0 || stacknum >= DOTSF_MAX_STACKS){return false;}
+    dotsf_stack* stack = interp->stacks+stacknum;
+    if (stack->count <= 0){return false;}
+    //the bottom element moves into the slot right above the top, which is its own slot when the stack is full.
+    dotsf_int v = stack->stack[stack->head];
+    if (++(stack->head) == stack->cap){stack->head = 0;}
+    *_dotsf_slot(stack, stack->count-1) = v;
     return true;
 }
 bool _dotsf_gettop(dotsf_interpreter* interp, dotsf_int stacknum, dotsf_int* out)
 {
     if (stacknum < 0 || stacknum >= DOTSF_MAX_STACKS){return false;}
     dotsf_stack* stack = interp->stacks+stacknum;
-    if (stack->stacktop < 0){return false;}
-    *out = stack->stack[stack->stacktop];
+    if (stack->count <= 0){return false;}
+    *out = *_dotsf_slot(stack, stack->count-1);
     return true;
 }
 bool _dotsf_getbottom(dotsf_interpreter* interp, dotsf_int stacknum, dotsf_int* out)
 {
     if (stacknum < 0 || stacknum >= DOTSF_MAX_STACKS){return false;}
     dotsf_stack* stack = interp->stacks+stacknum;
-    if (stack->stacktop < 0){return false;}
-    *out = stack->stack[0];
+    if (stack->count <= 0){return false;}
+    *out = stack->stack[stack->head];
+    return true;
+}
+void _dotsf_clear_stack(dotsf_stack* stack)
+{
+    stack->head = 0;
+    stack->count = 0;
+}
+/*
+    The bulk #s operations. Elements are moved a contiguous run of the circular buffers at a time, which is at most three
+    memmoves however many there are, instead of a pop, a push and their checks for each one.
+*/
+void _dotsf_copy_slots(dotsf_stack* dst, dotsf_int to, dotsf_stack* src, dotsf_int from, dotsf_int n) //copies n elements of src starting at from (counting up from the bottom) over the ones of dst starting at to.
+{
+    while (n > 0)
+    {
+        dotsf_int *s = _dotsf_slot(src, from), *d = _dotsf_slot(dst, to), run = n;
+        if (run > src->stack+src->cap-s){run = src->stack+src->cap-s;}
+        if (run > dst->stack+dst->cap-d){run = dst->stack+dst->cap-d;}
+        memmove(d, s, sizeof(dotsf_int)*run);
+        from += run;
+        to += run;
+        n -= run;
+    }
+}
+//puts the top n elements of the current stack on top of stack stacknum in the same order, removing them from the current one if move.
+//returns 0, 1 if stacknum isn't a stack, 2 if n is negative or more than the current stack holds or 3 if stacknum has no room for them.
+int _dotsf_transfer(dotsf_interpreter* interp, dotsf_int stacknum, dotsf_int n, bool move)
+{
+    if (stacknum < 0 || stacknum >= DOTSF_MAX_STACKS || !interp->stacks[stacknum].in_use){return 1;}
+    dotsf_stack *src = interp->stacks+interp->curstack, *dst = interp->stacks+stacknum;
+    if (n < 0 || n > src->count){return 2;}
+    if (move && src == dst){return 0;} //moving the top of a stack onto itself leaves it as it was.
+    if (!_dotsf_reserve(dst, n)){return 3;}
+    _dotsf_copy_slots(dst, dst->count, src, src->count-n, n);
+    dst->count += n;
+    if (move){src->count -= n;}
+    return 0;
+}
+bool _dotsf_reverse_top(dotsf_stack* stack, dotsf_int n) //false if n is negative or more than stack holds.
+{
+    if (n < 0 || n > stack->count){return false;}
+    if (n < 2){return true;}
+    dotsf_int *lo = _dotsf_slot(stack, stack->count-n), *hi = lo+n-1, t;
+    if (hi < stack->stack+stack->cap) //the usual case, the elements don't wrap around.
+    {
+        for (; lo < hi; lo++, hi--){t = *lo; *lo = *hi; *hi = t;}
+        return true;
+    }
+    for (dotsf_int i = stack->count-n, j = stack->count-1; i < j; i++, j--)
+    {
+        lo = _dotsf_slot(stack, i);
+        hi = _dotsf_slot(stack, j);
+        t = *lo; *lo = *hi; *hi = t;
+    }
+    return true;
+}
+bool _dotsf_fill_top(dotsf_stack* stack, dotsf_int n, dotsf_int value) //overwrites the top n elements with value, false if n is negative or more than stack holds.
+{
+    if (n < 0 || n > stack->count){return false;}
+    for (dotsf_int i = stack->count-n; i < stack->count; )
+    {
+        dotsf_int *p = _dotsf_slot(stack, i), run = stack->count-i;
+        if (run > stack->stack+stack->cap-p){run = stack->stack+stack->cap-p;}
+        for (dotsf_int k = 0; k < run; k++){p[k] = value;}
+        i += run;
+    }
     return true;
 }
 int _dotsf_delete_stack(dotsf_interpreter* interp, dotsf_int stacknum)
@@ -123,10 +377,15 @@ int _dotsf_delete_stack(dotsf_interpreter* interp, dotsf_int stacknum)
     dotsf_stack* stack = interp->stacks+stacknum;
     if (stack->in_use)
     {
-        free(stack->stack);
+        if (stack->stack != NULL && interp->nspares < DOTSF_MAX_STACKS)
+        {
+            interp->spares[interp->nspares++] = (dotsf_spare){.stack=stack->stack, .cap=stack->cap};
+        }
+        else {free(stack->stack);}
         stack->stack = NULL;
+        stack->cap = 0;
         stack->maxstack = 0;
-        stack->stacktop = -1;
+        _dotsf_clear_stack(stack);
         stack->in_use = false;
         return 0;
     }
@@ -155,448 +414,2874 @@ int _dotsf_create_stack(dotsf_interpreter* interp, dotsf_int stacknum, dotsf_int
         if (stack->in_use){return 3;}
         if (outindex != NULL){*outindex = stacknum;}
         stack->maxstack = maxstack;
-        stack->stacktop = -1;
-        stack->stack = malloc(sizeof(dotsf_int)*maxstack);
+        _dotsf_clear_stack(stack);
+        //memory is only taken on the first push, unless a deleted stack left a buffer behind.
+        if (interp->nspares > 0)
+        {
+            dotsf_spare spare = interp->spares[--(interp->nspares)];
+            stack->stack = spare.stack;
+            stack->cap = (spare.cap <= maxstack) ? (spare.cap) : ((maxstack > 0) ? (maxstack) : (0)); //cap never passes maxstack, the JIT relies on it.
+        }
         stack->in_use = true;
         if (!_dotsf_push(interp, stacknum)){return 4;}
         return 0;
 }
-int dotsf_exec(dotsf_interpreter* interp, char* src)
+uint64_t _dotsf_now_ns(void) //a monotonic clock for timing, not the time of day.
 {
-    #define _dotsf_modulus(a, b) ((a < 0) ? (b) : ((__typeof__(b))0))+(a-(b*((__typeof__(a))(ssize_t)((double)a/(double)b))))
-    typedef struct _dotsf_lbl {
-        bool active;
-        char* jmploc;
-        dotsf_int rank1, ierank1;
-    } _dotsf_lbl;
-    
-    _dotsf_lbl labels[26] = { };
-    char* hashopend = NULL;
-    char hashopval[DOTSF_MAX_HASHOP_VAL_SIZE] = { };
-    dotsf_int _snum1, v1, v2, v3, rank1 = 0, ierank1 = 0;
-    dotsf_stack* stack = NULL;
-    //ierank1 = 0;
-    int count = 0;
-    int status1, status2, status3, status4;
-    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++)
+    struct timespec ts;
+    #ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    #else
+    timespec_get(&ts, TIME_UTC);
+    #endif
+    return (uint64_t)ts.tv_sec*1000000000u+ts.tv_nsec;
+}
+/*
+    Everything a program prints goes through interp->out and reaches interp->io.write in large blocks.
+    The buffer is flushed when it fills up, before every read from the input, after every ` dump and when the program ends.
+*/
+ptrdiff_t _dotsf_std_write(void* ctx, const void* buf, size_t size) //the default dotsf_io, stdout.
+{
+    (void)ctx;
+    ssize_t n;
+    do {n = write(STDOUT_FILENO, buf, size);} while (n < 0 && errno == EINTR);
+    return n;
+}
+ptrdiff_t _dotsf_std_read(void* ctx, void* buf, size_t size) //and stdin.
+{
+    (void)ctx;
+    ssize_t n;
+    do {n = read(STDIN_FILENO, buf, size);} while (n < 0 && errno == EINTR);
+    return n;
+}
+void _dotsf_flush(dotsf_interpreter* interp)
+{
+    dotsf_outbuf* out = &interp->out;
+    #if DOTSF_HAVE_PROFILE
+    bool timed = interp->profile != NULL && out->len > 0;
+    uint64_t started = (timed) ? (_dotsf_now_ns()) : (0);
+    #endif
+    for (size_t done = 0; done < out->len; )
     {
-        _dotsf_delete_stack(interp, si);
+        ptrdiff_t n = interp->io.write(interp->io.ctx, out->buf+done, out->len-done);
+        if (n <= 0){break;} //the output is gone, there is nowhere left to put it.
+        done += n;
     }
-    _dotsf_create_stack(interp, 0, DOTSF_MAX_STACK_SIZE, NULL);
-    _dotsf_pop(interp, &_snum1);
-    for (char* ip2 = src; *ip2; ip2++)
+    out->len = 0;
+    #if DOTSF_HAVE_PROFILE
+    if (timed){interp->profile->iotime += _dotsf_now_ns()-started; interp->profile->iocalls++;}
+    #endif
+}
+void _dotsf_out_bytes(dotsf_interpreter* interp, const char* bytes, size_t count)
+{
+    dotsf_outbuf* out = &interp->out;
+    while (count > 0)
     {
-        if (*ip2 == '!')
-        {
-            char* ending = strpbrk(ip2, "\r\n");
-            if (ending == NULL){break;}
-            ip2 = ending;
-        }
-        if (*ip2 == '?')
-        {
-            ierank1++;
-        }
-        if (*ip2 == '\'' && ierank1 > 0)
-        {
-            ierank1--;
-        }
-        if (*ip2 == '#')
-        {
-            if (*++ip2 == 'c'){ip2+=2;}
-            else
-            {
-                ip2 = strchr(ip2, '\\');
-                if (ip2 == NULL){return -50;}
-            }
-        }
-        
-        //if (*ip2 == '['){rank1++;}
-        //if (*ip2 == ']' && rank1 > 0){rank1--;}
-        if ((*ip2 >= 'A') && (*ip2 <= 'Z'))
+        if (out->len == DOTSF_OUT_BUF_SIZE){_dotsf_flush(interp);}
+        size_t n = DOTSF_OUT_BUF_SIZE-out->len;
+        if (n > count){n = count;}
+        memcpy(out->buf+out->len, bytes, n);
+        out->len += n;
+        bytes += n;
+        count -= n;
+    }
+}
+void _dotsf_out_char(dotsf_interpreter* interp, dotsf_int c) //same as putchar(c).
+{
+    dotsf_outbuf* out = &interp->out;
+    if (out->len == DOTSF_OUT_BUF_SIZE){_dotsf_flush(interp);}
+    out->buf[out->len++] = (char)c;
+    if (out->linebuffered && (char)c == '\n'){_dotsf_flush(interp);}
+}
+size_t _dotsf_format_int(char* digits, dotsf_int v) //same as sprintf(digits, "%i", v) without the NUL, digits needs room for 11 chars.
+{
+    char tmp[16];
+    size_t n = 0, len = 0;
+    unsigned int u = (v < 0) ? (0u-(unsigned int)v) : ((unsigned int)v);
+    do {tmp[n++] = '0'+(u%10); u /= 10;} while (u);
+    if (v < 0){digits[len++] = '-';}
+    while (n){digits[len++] = tmp[--n];}
+    return len;
+}
+void _dotsf_out_int(dotsf_interpreter* interp, dotsf_int v) //same as printf("%i\n", v).
+{
+    dotsf_outbuf* out = &interp->out;
+    if (DOTSF_OUT_BUF_SIZE-out->len < 16){_dotsf_flush(interp);}
+    out->len += _dotsf_format_int(out->buf+out->len, v);
+    out->buf[out->len++] = '\n';
+    if (out->linebuffered){_dotsf_flush(interp);}
+}
+/*
+    Everything a program reads comes out of interp->in, which is refilled from interp->io.read in large blocks.
+    _dotsf_in_int, _dotsf_in_char and _dotsf_in_line behave exactly like the scanf("%i"), getchar() and getchar() loop they replace.
+*/
+bool _dotsf_refill(dotsf_interpreter* interp) //false at EOF or on a read error, like getchar.
+{
+    dotsf_inbuf* in = &interp->in;
+    if (in->mapped){return false;}
+    #if DOTSF_HAVE_PROFILE
+    uint64_t started = (interp->profile != NULL) ? (_dotsf_now_ns()) : (0);
+    #endif
+    ptrdiff_t n = interp->io.read(interp->io.ctx, in->own, DOTSF_IN_BUF_SIZE);
+    #if DOTSF_HAVE_PROFILE
+    if (interp->profile != NULL){interp->profile->iotime += _dotsf_now_ns()-started; interp->profile->iocalls++;}
+    #endif
+    if (n <= 0){return false;}
+    in->data = in->own;
+    in->pos = 0;
+    in->len = n;
+    return true;
+}
+int _dotsf_in_peek(dotsf_interpreter* interp)
+{
+    dotsf_inbuf* in = &interp->in;
+    if (in->pos == in->len && !_dotsf_refill(interp)){return EOF;}
+    return in->data[in->pos];
+}
+int _dotsf_in_char(dotsf_interpreter* interp)
+{
+    int c = _dotsf_in_peek(interp);
+    if (c != EOF){interp->in.pos++;}
+    return c;
+}
+int _dotsf_digit_value(int c, int base) //-1 if c isn't a digit in base.
+{
+    int d = (c >= '0' && c <= '9') ? (c-'0') : ((c >= 'a' && c <= 'z') ? (c-'a'+10) : ((c >= 'A' && c <= 'Z') ? (c-'A'+10) : (-1)));
+    return (d < base) ? (d) : (-1);
+}
+int _dotsf_in_int(dotsf_interpreter* interp, dotsf_int* out) //returns 1, 0 or EOF just like scanf("%i", out).
+{
+    int c, base = 10, d;
+    bool neg = false, overflow = false;
+    unsigned long mag = 0;
+    while ((c = _dotsf_in_peek(interp)) != EOF && isspace(c)){interp->in.pos++;}
+    if (c == EOF){return EOF;}
+    if (c == '-' || c == '+'){neg = (c == '-'); interp->in.pos++; c = _dotsf_in_peek(interp);}
+    if (c == '0')
+    {
+        //a leading 0 is octal and 0x is hex, a lone 0 or 0x still reads as 0.
+        interp->in.pos++;
+        c = _dotsf_in_peek(interp);
+        if (c == 'x' || c == 'X'){interp->in.pos++; base = 16;}
+        else {base = 8;}
+    }
+    else if (_dotsf_digit_value(c, 10) < 0){return 0;}
+    while ((d = _dotsf_digit_value(_dotsf_in_peek(interp), base)) >= 0)
+    {
+        interp->in.pos++;
+        if (mag > (ULONG_MAX-d)/base){overflow = true;}
+        else {mag = mag*base+d;}
+    }
+    //the value saturates like strtol's and is then truncated to an int, which is what scanf does too.
+    long v;
+    if (neg){v = (overflow || mag > (unsigned long)LONG_MAX+1) ? (LONG_MIN) : ((long)(0ul-mag));}
+    else {v = (overflow || mag > LONG_MAX) ? (LONG_MAX) : ((long)mag);}
+    *out = (dotsf_int)v;
+    return 1;
+}
+int _dotsf_in_line(dotsf_interpreter* interp) //pushes the next line and a 0 onto the current stack, returns 0 or the same error status as ".
+{
+    dotsf_inbuf* in = &interp->in;
+    dotsf_stack* stack = interp->stacks+interp->curstack;
+    while (in->pos < in->len || _dotsf_refill(interp))
+    {
+        const unsigned char* start = in->data+in->pos;
+        size_t avail = in->len-in->pos;
+        const unsigned char* end = memchr(start, '\n', avail);
+        const unsigned char* cr = memchr(start, '\r', (end) ? ((size_t)(end-start)) : (avail));
+        if (cr != NULL){end = cr;}
+        size_t n = (end) ? ((size_t)(end-start)) : (avail);
+        if (n > (size_t)INT_MAX || !_dotsf_reserve(stack, n)){return -31;}
+        //the line lands in at most two contiguous runs of the circular buffer.
+        for (size_t done = 0; done < n; )
         {
-            //printf("new label: %c\n", *ip2);
-            labels[(*ip2)-'A'] = (_dotsf_lbl){.active=true, .jmploc=ip2, .rank1=rank1, .ierank1=ierank1};
+            dotsf_int* dst = _dotsf_slot(stack, stack->count);
+            size_t run = stack->stack+stack->cap-dst;
+            if (run > n-done){run = n-done;}
+            for (size_t i = 0; i < run; i++){dst[i] = start[done+i];}
+            stack->count += run;
+            done += run;
         }
+        in->pos += n;
+        if (end != NULL){in->pos++; break;} //the \r or \n itself is consumed but not pushed.
+    }
+    if (!_dotsf_push(interp, 0)){return -32;}
+    return 0;
+}
+bool _dotsf_map_stdin(dotsf_interpreter* interp) //reads stdin straight out of the page cache when it is a regular file, only for the default dotsf_io.
+{
+    #if DOTSF_HAVE_MMAP
+    struct stat st;
+    dotsf_inbuf* in = &interp->in;
+    if (fstat(STDIN_FILENO, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0){return false;}
+    off_t start = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (start < 0 || start >= st.st_size){return false;}
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+    if (map == MAP_FAILED){return false;}
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    in->data = (const unsigned char*)map;
+    in->pos = start;
+    in->len = st.st_size;
+    in->mapped = true;
+    return true;
+    #else
+    (void)interp;
+    return false;
+    #endif
+}
+bool _dotsf_emit(dotsf_program* prog, dotsf_opcode op, dotsf_int arg, size_t srcoff)
+{
+    if (prog->len == prog->cap)
+    {
+        size_t newcap = (prog->cap) ? (prog->cap*2) : 64;
+        dotsf_insn* newcode = realloc(prog->code, sizeof(dotsf_insn)*newcap);
+        if (newcode == NULL){return false;}
+        prog->code = newcode;
+        uint32_t* newsrcmap = realloc(prog->srcmap, sizeof(uint32_t)*newcap);
+        if (newsrcmap == NULL){return false;}
+        prog->srcmap = newsrcmap;
+        prog->cap = newcap;
+    }
+    prog->srcmap[prog->len] = srcoff;
+    prog->code[prog->len++] = (dotsf_insn){.op=op, .arg=arg};
+    return true;
+}
+void dotsf_free_program(dotsf_program* prog)
+{
+    #if DOTSF_HAVE_JIT
+    if (prog->jitcode != NULL){munmap(prog->jitcode, prog->jitsize);}
+    #endif
+    #if DOTSF_HAVE_MMAP
+    if (prog->map != NULL){munmap(prog->map, prog->mapsize);}
+    else
+    #endif
+    {free(prog->code); free(prog->srcmap); free(prog->snap);}
+    *prog = (dotsf_program){ };
+}
+dotsf_opcode _dotsf_find_hashop(char kind, const char* name) //returns DOTSF_OP_COUNT for names that aren't #g or #s operations.
+{
+    static const struct {
+        char kind;
+        const char* name;
+        dotsf_opcode op;
+    } hashops[] = {
+        {'g', "cs", DOTSF_OP_GCS},
+        {'s', "ns", DOTSF_OP_NS}, {'s', "ds", DOTSF_OP_DS},
+        {'s', "tfa", DOTSF_OP_TFA}, {'s', "tfb", DOTSF_OP_TFB}, {'s', "tfc", DOTSF_OP_TFC}, {'s', "tfd", DOTSF_OP_TFD},
+        {'s', "tfe", DOTSF_OP_TFE}, {'s', "tff", DOTSF_OP_TFF}, {'s', "tfg", DOTSF_OP_TFG}, {'s', "tfh", DOTSF_OP_TFH},
+        {'s', "cs", DOTSF_OP_CS}, {'s', "clr", DOTSF_OP_CLR},
+        {'s', "mvn", DOTSF_OP_MVN}, {'s', "cpn", DOTSF_OP_CPN}, {'s', "mva", DOTSF_OP_MVA}, {'s', "cpa", DOTSF_OP_CPA},
+        {'s', "rev", DOTSF_OP_REV}, {'s', "fill", DOTSF_OP_FILL}
+    };
+    for (size_t i = 0; i < sizeof(hashops)/sizeof(hashops[0]); i++)
+    {
+        if (hashops[i].kind == kind && strcmp(hashops[i].name, name) == 0){return hashops[i].op;}
+    }
+    return DOTSF_OP_COUNT;
+}
+/*
+    The scanner dotsf_compile uses to skip what doesn't become an instruction: runs of whitespace, and comments up to
+    the end of their line. With SSE2 or AVX2 it classifies a whole aligned block of the source per step and jumps straight
+    to the first byte that matters. Aligned loads never cross into a page that holds none of the source, so reading a
+    block that runs past the terminating NUL is safe, though AddressSanitizer can't know that.
+*/
+#if DOTSF_SIMD_WIDTH
+#if defined(__GNUC__)
+#define DOTSF_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define DOTSF_NO_ASAN
+#endif
+#if DOTSF_SIMD_WIDTH == 32
+typedef __m256i dotsf_simd;
+#define _dotsf_simd_load(p) _mm256_load_si256((const __m256i*)(p))
+#define _dotsf_simd_set1(c) _mm256_set1_epi8(c)
+#define _dotsf_simd_eq(a, b) _mm256_cmpeq_epi8(a, b)
+#define _dotsf_simd_gt(a, b) _mm256_cmpgt_epi8(a, b)
+#define _dotsf_simd_or(a, b) _mm256_or_si256(a, b)
+#define _dotsf_simd_xor(a, b) _mm256_xor_si256(a, b)
+#define _dotsf_simd_mask(v) (uint32_t)_mm256_movemask_epi8(v)
+#else
+typedef __m128i dotsf_simd;
+#define _dotsf_simd_load(p) _mm_load_si128((const __m128i*)(p))
+#define _dotsf_simd_set1(c) _mm_set1_epi8(c)
+#define _dotsf_simd_eq(a, b) _mm_cmpeq_epi8(a, b)
+#define _dotsf_simd_gt(a, b) _mm_cmpgt_epi8(a, b)
+#define _dotsf_simd_or(a, b) _mm_or_si128(a, b)
+#define _dotsf_simd_xor(a, b) _mm_xor_si128(a, b)
+#define _dotsf_simd_mask(v) (uint32_t)_mm_movemask_epi8(v)
+#endif
+DOTSF_NO_ASAN uint32_t _dotsf_blank_mask(const char* block) //a bit for every byte that isn't whitespace or a control character, or is the NUL.
+{
+    dotsf_simd v = _dotsf_simd_load(block), bias = _dotsf_simd_set1((char)0x80);
+    //SIMD compares are signed, flipping the top bit turns them into unsigned ones so bytes >= 0x80 count as visible.
+    dotsf_simd visible = _dotsf_simd_gt(_dotsf_simd_xor(v, bias), _dotsf_simd_set1((char)(' '^0x80)));
+    return _dotsf_simd_mask(_dotsf_simd_or(visible, _dotsf_simd_eq(v, _dotsf_simd_set1(0))));
+}
+DOTSF_NO_ASAN uint32_t _dotsf_eol_mask(const char* block) //a bit for every \r, \n and NUL.
+{
+    dotsf_simd v = _dotsf_simd_load(block);
+    dotsf_simd eol = _dotsf_simd_or(_dotsf_simd_eq(v, _dotsf_simd_set1('\n')), _dotsf_simd_eq(v, _dotsf_simd_set1('\r')));
+    return _dotsf_simd_mask(_dotsf_simd_or(eol, _dotsf_simd_eq(v, _dotsf_simd_set1(0))));
+}
+const char* _dotsf_simd_find(const char* ip, uint32_t (*mask)(const char*)) //the first byte at or after ip with its bit set in mask.
+{
+    const char* block = (const char*)((uintptr_t)ip & ~(uintptr_t)(DOTSF_SIMD_WIDTH-1));
+    uint32_t bits = mask(block) & (uint32_t)(~(uint64_t)0 << (ip-block));
+    while (bits == 0)
+    {
+        block += DOTSF_SIMD_WIDTH;
+        bits = mask(block);
     }
-    rank1 = 0; ierank1 = 0;
-    for (char* ip = src; ; ip++)
+    return block+__builtin_ctz(bits);
+}
+#endif
+const char* _dotsf_skip_blank(const char* ip) //the first byte at or after ip that isn't whitespace or a control character.
+{
+    //a lone space between two tokens is the common case and not worth a block load.
+    if ((unsigned char)ip[0] > ' ' || ip[0] == 0){return ip;}
+    if ((unsigned char)ip[1] > ' ' || ip[1] == 0){return ip+1;}
+    #if DOTSF_SIMD_WIDTH
+    return _dotsf_simd_find(ip+2, _dotsf_blank_mask);
+    #else
+    for (ip += 2; (unsigned char)*ip <= ' ' && *ip; ip++){}
+    return ip;
+    #endif
+}
+const char* _dotsf_find_eol(const char* ip) //the first \r, \n or the NUL at or after ip.
+{
+    #if DOTSF_SIMD_WIDTH
+    return _dotsf_simd_find(ip, _dotsf_eol_mask);
+    #else
+    while (*ip && *ip != '\n' && *ip != '\r'){ip++;}
+    return ip;
+    #endif
+}
+int dotsf_compile(dotsf_program* prog, const char* src)
+{
+    /*
+        Besides decoding, this pass resolves every jump:
+        labels become instruction indices, a [ jumps past its ], a ? jumps past its | and a | jumps past its '.
+        Open [ and ? blocks are chained through their arg until their closing character is seen.
+        Nesting errors are returned here, before anything runs:
+        -1 = [ without ], -2 = ] without [, -201 = ? without |, -202 = | without ', -204 = | without ?, -205 = ' without |.
+        So are malformed # operations:
+        -50 = no closing \\, -51 = value too long, -53 = #n value is not a number, -55 = unknown #g or #s name, -60 = unknown # letter.
+    */
+    dotsf_int labels[26], v1 = 0, openbr = -1, openif = -1;
+    const char* hashopend = NULL;
+    char hashopval[DOTSF_MAX_HASHOP_VAL_SIZE] = { };
+    bool ok = true;
+    int status = 0;
+    size_t erroff = 0;
+    *prog = (dotsf_program){ };
+    for (int i = 0; i < 26; i++){labels[i] = -1;}
+    for (const char* ip = src; ok; ip++)
     {
-        //printf("ip = %p\n", ip);
-        if (*ip == 0){return 0;}
-        else if (*ip == '!') //single-line comment
+        if (*(ip = _dotsf_skip_blank(ip)) == 0){break;}
+        size_t off = ip-src;
+        if (*ip == '!') //single-line comment, a comment that runs to EOF ends the program.
         {
-            char* ending = strpbrk(ip, "\r\n"); //find the next linefeed.
-            if (ending == NULL){return 0;} //comment goes to EOF.
-            //printf("comment length = %zu\n", (size_t)(ending-ip));
+            const char* ending = _dotsf_find_eol(ip);
+            if (*ending == 0){break;}
             ip = ending;
-            continue;
-        }   
-        else if ((*ip >= 'a') && (*ip <= 'z'))
-        {
-            //printf("lblname = %c\n", *ip);
-            //printf("lblpos = %zu\n", (size_t)(ip-src));
-            _dotsf_lbl lbl = labels[(*ip)-'a'];
-            if (!lbl.active){return -222;}
-            ip = lbl.jmploc;
-            ierank1 = lbl.ierank1;
-            rank1 = lbl.rank1;
         }
-        else if (*ip == '[')
+        else if ((*ip >= 'A') && (*ip <= 'Z')){labels[(*ip)-'A'] = prog->len;} //the last definition of a label wins.
+        else if ((*ip >= 'a') && (*ip <= 'z')){ok = _dotsf_emit(prog, DOTSF_OP_JMP, (*ip)-'a', off);} //resolved once every label is known.
+        else if (*ip >= '0' && *ip <= '9'){ok = _dotsf_emit(prog, DOTSF_OP_PUSHD, (*ip)-'0', off);}
+        else if (*ip == '#')
         {
-            char* ending;
-            if (!_dotsf_pop(interp, &v1)){return -10;}
-            else if (!v1)
+            ip++;
+            if (*ip == 'c')
             {
-                ip++;
-                for (rank1 = 1; ; ip++)
-                {
-                    switch (*ip)
-                    {
-                        case '!':
-                            if ((ending = strpbrk(ip, "\r\n")) == NULL){return -203;}
-                            ip = ending;
-                            break;
-                        case '[': rank1++; break;
-                        case ']': rank1--; break;
-                        case '\0': return -1;
-                        default: break;
-                    }
-                    if (rank1 == 0){break;}
-                }
+                ok = _dotsf_emit(prog, DOTSF_OP_PUSHC, *++ip, off);
+                if (*ip == 0){break;}
+                continue;
             }
-            else {;}    
-        }
-        else if (*ip >= '0' && *ip <= '9'){if (!_dotsf_push(interp, (*ip)-'0')){return -13;}}
-        else if (*ip == ':'){if (!_dotsf_pop(interp, &v1)){return -10;} printf("%i\n", v1);}
-        else if (*ip == ';'){if (!_dotsf_pop(interp, &v1)){return -10;} putchar(v1);}
-        else if (*ip == '+')
-        {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, v1+v2)){return -16;}
-            else {;}
-        }
-        else if (*ip == '-')
-        {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, v1-v2)){return -16;}
-            else {;}
+            hashopend = strchr(ip, '\\');
+            if (hashopend == NULL){status = -50; erroff = off; goto failed;}
+            if (hashopend-(ip+1) >= DOTSF_MAX_HASHOP_VAL_SIZE){status = -51; erroff = off; goto failed;}
+            memset(hashopval, 0, DOTSF_MAX_HASHOP_VAL_SIZE);
+            memcpy(hashopval, ip+1, hashopend-(ip+1));
+            if (*ip == 'n')
+            {
+                char* numend;
+                v1 = strtol(hashopval, &numend, 0); //what sscanf's %i does, without the format string parsing.
+                if (numend == hashopval){status = -53; erroff = off; goto failed;}
+                ok = _dotsf_emit(prog, DOTSF_OP_PUSHN, v1, off);
+            }
+            else if (*ip == 'g' || *ip == 's')
+            {
+                dotsf_opcode op = _dotsf_find_hashop(*ip, hashopval);
+                if (op == DOTSF_OP_COUNT){status = -55; erroff = off; goto failed;}
+                ok = _dotsf_emit(prog, op, 0, off);
+            }
+            else {status = -60; erroff = off; goto failed;}
+            ip = hashopend;
         }
-        else if (*ip == '*')
+        else if (*ip == '[')
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, v1*v2)){return -16;}
-            else {;}
+            ok = _dotsf_emit(prog, DOTSF_OP_IFZ, openbr, off);
+            openbr = prog->len-1;
         }
-        else if (*ip == '/')
+        else if (*ip == ']')
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, v1/v2)){return -16;}
-            else {;}
+            if (openbr < 0){status = -2; erroff = off; goto failed;}
+            dotsf_insn* opener = prog->code+openbr;
+            openbr = opener->arg;
+            opener->arg = prog->len;
         }
-        else if (*ip == '%')
+        else if (*ip == '?')
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, _dotsf_modulus(v1, v2))){return -16;}
-            else {;}
+            ok = _dotsf_emit(prog, DOTSF_OP_IF, openif, off);
+            openif = prog->len-1;
         }
-        else if (*ip == '=')
+        else if (*ip == '|')
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, (dotsf_int)(v1 == v2))){return -16;}
-            else {;}
+            if (openif < 0 || prog->code[openif].op != DOTSF_OP_IF){status = -204; erroff = off; goto failed;}
+            ok = _dotsf_emit(prog, DOTSF_OP_ELSE, prog->code[openif].arg, off);
+            prog->code[openif].arg = prog->len;
+            openif = prog->len-1;
         }
-        else if (*ip == '>')
+        else if (*ip == '\'')
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, (dotsf_int)(v1 > v2))){return -16;}
-            else {;}
+            if (openif < 0 || prog->code[openif].op != DOTSF_OP_ELSE){status = -205; erroff = off; goto failed;}
+            dotsf_insn* opener = prog->code+openif;
+            openif = opener->arg;
+            opener->arg = prog->len;
         }
-        else if (*ip == '<')
+        else
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, (dotsf_int)(v1 < v2))){return -16;}
-            else {;}
+            dotsf_opcode op;
+            switch (*ip)
+            {
+                case ':': op = DOTSF_OP_PRINTI; break;
+                case ';': op = DOTSF_OP_PRINTC; break;
+                case '+': op = DOTSF_OP_ADD; break;
+                case '-': op = DOTSF_OP_SUB; break;
+                case '*': op = DOTSF_OP_MUL; break;
+                case '/': op = DOTSF_OP_DIV; break;
+                case '%': op = DOTSF_OP_MOD; break;
+                case '=': op = DOTSF_OP_EQ; break;
+                case '>': op = DOTSF_OP_GT; break;
+                case '<': op = DOTSF_OP_LT; break;
+                case '&': op = DOTSF_OP_AND; break;
+                case '{': op = DOTSF_OP_LE; break;
+                case '}': op = DOTSF_OP_GE; break;
+                case '.': op = DOTSF_OP_READI; break;
+                case ',': op = DOTSF_OP_READC; break;
+                case '_': op = DOTSF_OP_DUP; break;
+                case '@': op = DOTSF_OP_DUP2; break;
+                case '"': op = DOTSF_OP_READL; break;
+                case '~': op = DOTSF_OP_ROT; break;
+                case '`': op = DOTSF_OP_DUMP; break;
+                default: continue; //whitespace and anything else without a meaning.
+            }
+            ok = _dotsf_emit(prog, op, 0, off);
         }
-        else if (*ip == '&')
+    }
+    if (!ok || !_dotsf_emit(prog, DOTSF_OP_END, 0, 0)){status = -400; goto failed;}
+    if (openbr >= 0){status = -1; erroff = prog->srcmap[openbr]; goto failed;}
+    if (openif >= 0)
+    {
+        status = (prog->code[openif].op == DOTSF_OP_IF) ? -201 : -202;
+        erroff = prog->srcmap[openif];
+        goto failed;
+    }
+    for (size_t pc = 0; pc < prog->len; pc++)
+    {
+        dotsf_insn* insn = prog->code+pc;
+        if (insn->op != DOTSF_OP_JMP){continue;}
+        if (labels[insn->arg] < 0){*insn = (dotsf_insn){.op=DOTSF_OP_FAIL, .arg=-222};}
+        else {insn->arg = labels[insn->arg];}
+    }
+    return 0;
+    failed:
+        dotsf_free_program(prog);
+        prog->erroff = erroff;
+        return status;
+}
+//% divides in floating point and never traps. By 0 it gives back the dividend and by -1 it gives -1 or 0, as it always has,
+//but spelled out, since the formula only got there through an out of range conversion or an overflow.
+#define _dotsf_modulus(a, b) (((b) == 0) ? (a) : (((b) == -1) ? (((a) < 0) ? (-1) : (0)) \
+    : (((a < 0) ? (b) : ((__typeof__(b))0))+(a-(b*((__typeof__(a))(ssize_t)((double)a/(double)b)))))))
+//a / by 0, or of INT_MIN by -1, fails with status -133 instead of raising SIGFPE, which would take a whole --batch or --serve process (or whatever embeds it) down.
+#define _dotsf_div_traps(a, b) ((b) == 0 || ((a) == INT_MIN && (b) == -1))
+/*
+    dotsf_optimize rewrites common idioms into the superinstructions at the end of DOTSF_OPCODES:
+        a push followed by + - * / % = > < & { or }   ->  ADDK..GEK, which work on the top element in place.
+        a push followed by one of those, repeatedly   ->  PUSHF, the folded constant (multi-digit numbers like 99*9+).
+        a push followed by ; or :                     ->  PRINTCK or PRINTIK, which never touch the stack.
+        _ followed by [ or ?                          ->  DUPJZ.
+        _ k followed by = > < & { or } and [ or ?     ->  DJEQK..DJGEK.
+    Fused instructions return the same error status the sequence they replace would have.
+    Nothing is fused across a jump target, and every jump is renumbered once the program has been compacted.
+    Then _dotsf_loop_idioms puts an instruction that runs the whole loop at once in front of loops that only count,
+    drain or move elements. Last, _dotsf_guard_blocks works out how deep the stack has to be and how far it grows over each straight run of
+    instructions that only push, pop and print, so a single GUARD can check that once and run the whole run unchecked.
+*/
+bool _dotsf_is_jump(dotsf_opcode op) //instructions whose arg is the index they may jump to.
+{
+    return op == DOTSF_OP_JMP || op == DOTSF_OP_IFZ || op == DOTSF_OP_IF || op == DOTSF_OP_ELSE || op == DOTSF_OP_DUPJZ || (op >= DOTSF_OP_DJEQK && op <= DOTSF_OP_DJGEK)
+        || op == DOTSF_OP_LOOP || op == DOTSF_OP_DRAIN || op == DOTSF_OP_XFER;
+}
+int _dotsf_push_status(dotsf_opcode op) //what a push returns when the stack is full, 0 if op isn't a push.
+{
+    return (op == DOTSF_OP_PUSHD) ? (-13) : ((op == DOTSF_OP_PUSHC) ? (-52) : ((op == DOTSF_OP_PUSHN) ? (-54) : (0)));
+}
+bool _dotsf_fold(dotsf_opcode kop, dotsf_int a, dotsf_int b, dotsf_int* out) //computes a kop b at load time, false where that would trap.
+{
+    switch (kop)
+    {
+        case DOTSF_OP_ADDK: *out = (dotsf_int)((uint32_t)a+(uint32_t)b); return true;
+        case DOTSF_OP_SUBK: *out = (dotsf_int)((uint32_t)a-(uint32_t)b); return true;
+        case DOTSF_OP_MULK: *out = (dotsf_int)((uint32_t)a*(uint32_t)b); return true;
+        case DOTSF_OP_DIVK: if (_dotsf_div_traps(a, b)){return false;} *out = a/b; return true;
+        case DOTSF_OP_MODK: if (b == 0 || b == -1){return false;} *out = _dotsf_modulus(a, b); return true;
+        case DOTSF_OP_EQK: *out = (a == b); return true;
+        case DOTSF_OP_GTK: *out = (a > b); return true;
+        case DOTSF_OP_LTK: *out = (a < b); return true;
+        case DOTSF_OP_ANDK: *out = (a && b); return true;
+        case DOTSF_OP_LEK: *out = (a <= b); return true;
+        case DOTSF_OP_GEK: *out = (a >= b); return true;
+        default: return false;
+    }
+}
+size_t _dotsf_fuse(const dotsf_insn* code, size_t n, dotsf_insn* fused) //how many of the n instructions at code fuse into *fused, 0 if they don't.
+{
+    dotsf_opcode op0 = code[0].op, op1 = (n > 1) ? (code[1].op) : (DOTSF_OP_COUNT), op2 = (n > 2) ? (code[2].op) : (DOTSF_OP_COUNT);
+    int status0 = _dotsf_push_status(op0);
+    dotsf_int v;
+    if (op0 == DOTSF_OP_DUP && op1 >= DOTSF_OP_EQK && op1 <= DOTSF_OP_GEK && (op2 == DOTSF_OP_IFZ || op2 == DOTSF_OP_IF))
+    {
+        *fused = (dotsf_insn){.op=DOTSF_OP_DJEQK+(op1-DOTSF_OP_EQK), .err=code[1].err, .arg=code[2].arg, .arg2=code[1].arg};
+        return 3;
+    }
+    if (op0 == DOTSF_OP_DUP && (op1 == DOTSF_OP_IFZ || op1 == DOTSF_OP_IF)){*fused = (dotsf_insn){.op=DOTSF_OP_DUPJZ, .arg=code[1].arg}; return 2;}
+    if (status0 && op1 >= DOTSF_OP_ADD && op1 <= DOTSF_OP_GE)
+    {
+        *fused = (dotsf_insn){.op=DOTSF_OP_ADDK+(op1-DOTSF_OP_ADD), .err=status0, .arg=code[0].arg};
+        return 2;
+    }
+    if ((status0 || op0 == DOTSF_OP_PUSHF) && _dotsf_fold(op1, code[0].arg, code[1].arg, &v))
+    {
+        //the push folded into op1 was the second element on the stack, so its status becomes PUSHF's second one.
+        *fused = (status0) ? ((dotsf_insn){.op=DOTSF_OP_PUSHF, .err=status0, .arg=v, .arg2=code[1].err})
+            : ((dotsf_insn){.op=DOTSF_OP_PUSHF, .err=code[0].err, .arg=v, .arg2=code[0].arg2});
+        return 2;
+    }
+    if (status0 && (op1 == DOTSF_OP_PRINTC || op1 == DOTSF_OP_PRINTI))
+    {
+        *fused = (dotsf_insn){.op=(op1 == DOTSF_OP_PRINTC) ? (DOTSF_OP_PRINTCK) : (DOTSF_OP_PRINTIK), .err=status0, .arg=code[0].arg};
+        return 2;
+    }
+    return 0;
+}
+bool _dotsf_stack_effect(dotsf_opcode op, int* pops, int* room, int* delta) //false for instructions that do more than push, pop and print.
+{
+    /*
+        pops is how many elements op needs, room how far above its starting depth the stack gets while it runs
+        (the fused ops count the push they stand in for) and delta the depth it leaves behind.
+    */
+    switch (op)
+    {
+        case DOTSF_OP_PUSHD: case DOTSF_OP_PUSHC: case DOTSF_OP_PUSHN: *pops = 0; *room = 1; *delta = 1; return true;
+        case DOTSF_OP_PUSHF: *pops = 0; *room = 2; *delta = 1; return true;
+        case DOTSF_OP_PRINTCK: case DOTSF_OP_PRINTIK: *pops = 0; *room = 1; *delta = 0; return true;
+        case DOTSF_OP_PRINTI: case DOTSF_OP_PRINTC: *pops = 1; *room = 0; *delta = -1; return true;
+        case DOTSF_OP_DUP: *pops = 1; *room = 1; *delta = 1; return true;
+        case DOTSF_OP_DUP2: *pops = 2; *room = 2; *delta = 2; return true;
+        default:
+            if (op >= DOTSF_OP_ADD && op <= DOTSF_OP_GE){*pops = 2; *room = 0; *delta = -1; return true;}
+            if (op >= DOTSF_OP_ADDK && op <= DOTSF_OP_GEK){*pops = 1; *room = 1; *delta = 0; return true;}
+            return false;
+    }
+}
+bool _dotsf_guard_blocks(dotsf_program* prog) //puts a GUARD in front of every run of two or more instructions _dotsf_stack_effect knows.
+{
+    size_t cap = prog->len+prog->len/2+1, out = 0; //a GUARD covers at least two instructions, so this is always enough.
+    dotsf_insn* code = malloc(sizeof(dotsf_insn)*cap);
+    uint32_t* srcmap = malloc(sizeof(uint32_t)*cap);
+    bool* target = calloc(prog->len+1, sizeof(bool));
+    size_t* newpc = malloc(sizeof(size_t)*(prog->len+1));
+    if (code == NULL || srcmap == NULL || target == NULL || newpc == NULL){free(code); free(srcmap); free(target); free(newpc); return false;}
+    for (size_t pc = 0; pc < prog->len; pc++){if (_dotsf_is_jump(prog->code[pc].op)){target[prog->code[pc].arg] = true;}}
+    for (size_t pc = 0; pc < prog->len; )
+    {
+        //the depth a run needs on entry and the most it grows by, relative to where it starts.
+        int pops, room, delta, depth = 0, need = 0, grow = 0;
+        size_t run = 0;
+        while (pc+run < prog->len && run < UINT16_MAX && (run == 0 || !target[pc+run]) && _dotsf_stack_effect(prog->code[pc+run].op, &pops, &room, &delta))
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, (dotsf_int)(v1 && v2))){return -16;}
-            else {;}
+            if (pops-depth > need){need = pops-depth;}
+            if (depth+room > grow){grow = depth+room;}
+            depth += delta;
+            run++;
         }
-        else if (*ip == '{')
+        newpc[pc] = out; //jumps to the start of a run land on its GUARD.
+        if (run >= 2)
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, (dotsf_int)(v1 <= v2))){return -16;}
-            else {;}
+            srcmap[out] = prog->srcmap[pc];
+            code[out++] = (dotsf_insn){.op=DOTSF_OP_GUARD, .len=run, .arg=need, .arg2=grow};
         }
-        else if (*ip == '}')
+        else {run = 1;}
+        for (size_t end = pc+run; pc < end; pc++)
         {
-            if (!_dotsf_pop(interp, &v2)){return -14;}
-            else if (!_dotsf_pop(interp, &v1)){return -15;}
-            else if (!_dotsf_push(interp, (dotsf_int)(v1 >= v2))){return -16;}
-            else {;}
+            srcmap[out] = prog->srcmap[pc];
+            code[out++] = prog->code[pc];
         }
-        else if (*ip == '.')
+    }
+    newpc[prog->len] = out;
+    for (size_t pc = 0; pc < out; pc++){if (_dotsf_is_jump(code[pc].op)){code[pc].arg = newpc[code[pc].arg];}}
+    free(prog->code);
+    free(prog->srcmap);
+    prog->code = code;
+    prog->srcmap = srcmap;
+    prog->len = out;
+    prog->cap = cap;
+    free(target);
+    free(newpc);
+    return true;
+}
+/*
+    _dotsf_loop_idioms looks at every loop closed by a jump back to its label whose test is a _ [ at its start or end
+    (A _ [ ... a ] or A ... _ [ a ]) and whose body has no other jumps, and recognizes:
+        a body that only pushes, pops and does arithmetic, where every element it leaves behind is a constant or
+        the element that was in its place plus a constant, and the top one is the counter the _ [ tests
+                                      ->  LOOP, which works out how many times the loop runs from the counter and the
+                                          step it takes, then adds that many steps to every element at once.
+        the same, but the body only reads the counter and leaves more elements below it than it found (_ 1 - _ [ a ])
+                                      ->  LOOP, which writes the whole sequence out in one go.
+        A [ a ]                       ->  DRAIN, which drops everything down to and including the topmost 0.
+        a body of s #stfc\ or s #stfa\ ->  XFER, which moves everything up to the next 0 in one go.
+    ~ moves the bottom of the stack, so a body using it only has a closed form for one stack depth at a time;
+    it gets a LOOP for every depth up to DOTSF_LOOP_MAX_SLOTS that has one, each only taken when the stack is exactly that deep.
+    The loop itself stays where it was, with the new instruction at its label. When the counter doesn't reach 0 without
+    wrapping around, the stack is too shallow or has no room, or there is no 0 to stop at, the new instruction does nothing
+    and the loop runs as written, failing with its own status where it does. Loops with I/O or anything that could fail
+    on the way (a division by something that isn't a constant other than 0 and -1) are never touched.
+    A LOOP is followed by len LSLOTs, one per element from the deepest up, each the constant the element becomes (err set)
+    or what is added to it every time around. With DOTSF_LOOP_GROWS the first len-1 are what each time around leaves
+    below the counter, constants or the counter plus arg, and the last is the counter's step.
+*/
+#define DOTSF_LOOP_TEST_FIRST 1 //the loop starts with its _ [ instead of ending with it.
+#define DOTSF_LOOP_PINNED 2 //the body uses ~, the LOOP only holds when the stack is exactly len elements deep.
+#define DOTSF_LOOP_GROWS 4 //the body only reads the counter and leaves len-1 more elements below it.
+#define DOTSF_XFER_PULL 2 //XFER of #stfa\ rather than #stfc\.
+typedef struct dotsf_loop_val //what an element holds after running a loop body once, in terms of where it started.
+{
+    enum {DOTSF_LOOP_CONST, DOTSF_LOOP_SLOT, DOTSF_LOOP_OTHER} kind;
+    int slot; //DOTSF_LOOP_SLOT: the element that was slot places from the deepest one looked at, plus k.
+    uint32_t k;
+} dotsf_loop_val;
+dotsf_loop_val _dotsf_loop_binop(dotsf_opcode kop, dotsf_loop_val a, dotsf_loop_val b) //a kop b, kop being one of ADDK..GEK.
+{
+    dotsf_int v;
+    if (a.kind == DOTSF_LOOP_CONST && b.kind == DOTSF_LOOP_CONST && _dotsf_fold(kop, a.k, b.k, &v)){return (dotsf_loop_val){.kind=DOTSF_LOOP_CONST, .k=v};}
+    if ((kop == DOTSF_OP_MULK || kop == DOTSF_OP_ANDK) && b.kind == DOTSF_LOOP_CONST && b.k == 0){return b;} //whatever a was.
+    if ((kop == DOTSF_OP_MULK || kop == DOTSF_OP_ANDK) && a.kind == DOTSF_LOOP_CONST && a.k == 0){return a;}
+    if (a.kind == DOTSF_LOOP_SLOT && b.kind == DOTSF_LOOP_CONST)
+    {
+        if (kop == DOTSF_OP_ADDK){a.k += b.k; return a;}
+        if (kop == DOTSF_OP_SUBK){a.k -= b.k; return a;}
+        if ((kop == DOTSF_OP_MULK || kop == DOTSF_OP_DIVK) && b.k == 1){return a;}
+    }
+    if (a.kind == DOTSF_LOOP_CONST && b.kind == DOTSF_LOOP_SLOT && kop == DOTSF_OP_ADDK){b.k += a.k; return b;}
+    return (dotsf_loop_val){.kind=DOTSF_LOOP_OTHER};
+}
+bool _dotsf_loop_effect(const dotsf_insn* body, size_t n, bool testfirst, int* need, int* grow, int* delta, bool* rotates)
+{
+    //like _dotsf_stack_effect over the whole body and the _ [, false if the body does anything else or any I/O.
+    int pops, room, d, depth = 0;
+    *need = 1; //the _ [ needs the counter and room for its copy.
+    *grow = 1;
+    *rotates = false;
+    for (size_t i = 0; i < n; i++)
+    {
+        dotsf_opcode op = body[i].op;
+        if (op == DOTSF_OP_PRINTI || op == DOTSF_OP_PRINTC || op == DOTSF_OP_PRINTIK || op == DOTSF_OP_PRINTCK){return false;}
+        else if (op == DOTSF_OP_ROT){pops = 1; room = 0; d = 0; *rotates = true;}
+        else if (!_dotsf_stack_effect(op, &pops, &room, &d)){return false;}
+        if (pops-depth > *need){*need = pops-depth;}
+        if (depth+room > *grow){*grow = depth+room;}
+        depth += d;
+    }
+    if (!testfirst && 1-depth > *need){*need = 1-depth;}
+    if (!testfirst && depth+1 > *grow){*grow = depth+1;}
+    *delta = depth;
+    return true;
+}
+bool _dotsf_loop_follow(const dotsf_insn* body, size_t n, dotsf_loop_val* vals, int depth, bool pinned, int* end)
+{
+    //runs the body over vals, the depth elements it reads with the deepest first, false where it could fail.
+    int d = depth;
+    for (int i = 0; i < d; i++){vals[i] = (dotsf_loop_val){.kind=DOTSF_LOOP_SLOT, .slot=i};}
+    for (size_t i = 0; i < n; i++)
+    {
+        dotsf_opcode op = body[i].op, kop;
+        dotsf_loop_val b = {.kind=DOTSF_LOOP_CONST, .k=body[i].arg};
+        if (_dotsf_push_status(op) || op == DOTSF_OP_PUSHF){vals[d++] = b; continue;}
+        else if (op == DOTSF_OP_DUP && d >= 1){vals[d] = vals[d-1]; d++; continue;}
+        else if (op == DOTSF_OP_DUP2 && d >= 2){vals[d] = vals[d-2]; vals[d+1] = vals[d-1]; d += 2; continue;}
+        else if (op == DOTSF_OP_ROT && pinned && d >= 1) //vals is the whole stack.
         {
-            v1 = 0;
-            if (!scanf("%i", &v1)){return -17;}
-            else if (!_dotsf_push(interp, v1)){return -18;}
-            else {;}
+            dotsf_loop_val bottom = vals[0];
+            memmove(vals, vals+1, sizeof(dotsf_loop_val)*(d-1));
+            vals[d-1] = bottom;
+            continue;
         }
-        else if (*ip == ',')
+        else if (op >= DOTSF_OP_ADD && op <= DOTSF_OP_GE && d >= 2){b = vals[--d]; kop = DOTSF_OP_ADDK+(op-DOTSF_OP_ADD);}
+        else if (op >= DOTSF_OP_ADDK && op <= DOTSF_OP_GEK && d >= 1){kop = op;}
+        else {return false;}
+        if ((kop == DOTSF_OP_DIVK || kop == DOTSF_OP_MODK) && (b.kind != DOTSF_LOOP_CONST || b.k == 0 || b.k == (uint32_t)-1)){return false;}
+        vals[d-1] = _dotsf_loop_binop(kop, vals[d-1], b);
+    }
+    *end = d;
+    return true;
+}
+bool _dotsf_loop_closed(const dotsf_loop_val* vals, int depth, bool grows) //whether running the body again and again has a closed form.
+{
+    for (int i = 0; i < depth; i++)
+    {
+        if (vals[i].kind == DOTSF_LOOP_OTHER || (vals[i].kind == DOTSF_LOOP_SLOT && vals[i].slot != ((grows) ? (0) : (i)))){return false;}
+    }
+    return vals[depth-1].kind == DOTSF_LOOP_SLOT && vals[depth-1].k != 0; //the counter, which has to move.
+}
+size_t _dotsf_loop_emit(dotsf_insn* out, const dotsf_loop_val* vals, int depth, int flags, size_t exit, int grow)
+{
+    out[0] = (dotsf_insn){.op=DOTSF_OP_LOOP, .err=flags, .len=depth, .arg=exit, .arg2=grow};
+    for (int i = 0; i < depth; i++){out[i+1] = (dotsf_insn){.op=DOTSF_OP_LSLOT, .err=(vals[i].kind == DOTSF_LOOP_CONST), .arg=(dotsf_int)vals[i].k};}
+    return depth+1;
+}
+#define DOTSF_LOOP_MAX_EMIT (DOTSF_LOOP_MAX_SLOTS*4) //the most instructions put in front of one loop.
+size_t _dotsf_loop_test(const dotsf_insn* code, size_t pc, size_t end, size_t exit) //how long the _ [ to exit at pc is, fused or not, 0 if there is none before end.
+{
+    if (pc < end && code[pc].op == DOTSF_OP_DUPJZ && code[pc].arg == (dotsf_int)exit){return 1;}
+    if (pc+1 < end && code[pc].op == DOTSF_OP_DUP && code[pc+1].op == DOTSF_OP_IFZ && code[pc+1].arg == (dotsf_int)exit){return 2;} //left unfused for the JIT.
+    return 0;
+}
+size_t _dotsf_loop_match(const dotsf_program* prog, const bool* target, size_t jmp, dotsf_insn* out, dotsf_loop_val* vals)
+{
+    //how many instructions go in front of the loop the JMP at jmp closes, written to out, 0 if it isn't one of the idioms.
+    const dotsf_insn* code = prog->code;
+    size_t head = code[jmp].arg, exit = jmp+1, n, test, used = 0;
+    if (head > jmp){return 0;}
+    for (size_t pc = head+1; pc <= jmp; pc++){if (target[pc]){return 0;}}
+    if (jmp == head+1 && code[head].op == DOTSF_OP_IFZ && code[head].arg == (dotsf_int)exit)
+    {
+        out[0] = (dotsf_insn){.op=DOTSF_OP_DRAIN, .arg=exit};
+        return 1;
+    }
+    if (jmp == head){return 0;}
+    bool testfirst = (test = _dotsf_loop_test(code, head, jmp, exit)) > 0;
+    if (!testfirst)
+    {
+        if (_dotsf_loop_test(code, jmp-1, jmp, exit) == 1){test = 1;}
+        else if (jmp >= head+2 && _dotsf_loop_test(code, jmp-2, jmp, exit) == 2){test = 2;}
+        else {return 0;}
+    }
+    n = jmp-head-test; //the body, with whichever end the _ [ is at left out.
+    const dotsf_insn* body = code+head+((testfirst) ? (test) : (0));
+    int flags = (testfirst) ? (DOTSF_LOOP_TEST_FIRST) : (0), need, grow, delta, depth;
+    bool rotates;
+    if (n == 2 && (_dotsf_push_status(body[0].op) || body[0].op == DOTSF_OP_PUSHF) && (body[1].op == DOTSF_OP_TFC || body[1].op == DOTSF_OP_TFA))
+    {
+        out[0] = (dotsf_insn){.op=DOTSF_OP_XFER, .err=flags|((body[1].op == DOTSF_OP_TFA) ? (DOTSF_XFER_PULL) : (0)), .arg=exit, .arg2=body[0].arg};
+        return 1;
+    }
+    if (n > DOTSF_LOOP_MAX_BODY || !_dotsf_loop_effect(body, n, testfirst, &need, &grow, &delta, &rotates) || need > DOTSF_LOOP_MAX_SLOTS){return 0;}
+    if (!rotates && delta == 0 && _dotsf_loop_follow(body, n, vals, need, false, &depth) && _dotsf_loop_closed(vals, depth, false))
+    {
+        return _dotsf_loop_emit(out, vals, depth, flags, exit, grow);
+    }
+    if (!rotates && delta > 0 && need == 1 && delta < DOTSF_LOOP_MAX_SLOTS && _dotsf_loop_follow(body, n, vals, 1, false, &depth) && _dotsf_loop_closed(vals, depth, true))
+    {
+        return _dotsf_loop_emit(out, vals, depth, flags|DOTSF_LOOP_GROWS, exit, grow);
+    }
+    for (int pinned = need; rotates && delta == 0 && pinned <= DOTSF_LOOP_MAX_SLOTS && used+pinned+1 <= DOTSF_LOOP_MAX_EMIT; pinned++)
+    {
+        if (_dotsf_loop_follow(body, n, vals, pinned, true, &depth) && _dotsf_loop_closed(vals, depth, false))
         {
-            v1 = getchar();
-            if (v1 == EOF){v1 = 0;}
-            if (!_dotsf_push(interp, v1)){return -19;}
-            else {;}
+            used += _dotsf_loop_emit(out+used, vals, depth, flags|DOTSF_LOOP_PINNED, exit, grow);
         }
-        else if (*ip == '_')
+    }
+    return used;
+}
+bool _dotsf_loop_idioms(dotsf_program* prog) //false if memory ran out, prog is left as it was then.
+{
+    bool* target = calloc(prog->len+1, sizeof(bool));
+    size_t* newpc = malloc(sizeof(size_t)*(prog->len+1));
+    dotsf_loop_val* vals = malloc(sizeof(dotsf_loop_val)*(DOTSF_LOOP_MAX_SLOTS+2*DOTSF_LOOP_MAX_BODY+2));
+    size_t nextra = 0, capextra = 0, nloops = 0, caploops = 0;
+    dotsf_insn *extra = NULL, *code = NULL;
+    size_t* loops = NULL; //the label of every loop found and where its instructions end in extra, two entries each.
+    uint32_t* srcmap = NULL;
+    bool ok = target != NULL && newpc != NULL && vals != NULL;
+    for (size_t pc = 0; ok && pc < prog->len; pc++){if (_dotsf_is_jump(prog->code[pc].op)){target[prog->code[pc].arg] = true;}}
+    //loops with a straight-line body never overlap, so they come out ordered by their labels too.
+    for (size_t pc = 0; ok && pc < prog->len; pc++)
+    {
+        if (prog->code[pc].op != DOTSF_OP_JMP){continue;}
+        if (nextra+DOTSF_LOOP_MAX_EMIT > capextra)
         {
-            if (!_dotsf_pop(interp, &v1)){return -20;}
-            for (int i = 0; i < 2; i++){if (!_dotsf_push(interp, v1)){return -(21+i);}}
+            dotsf_insn* grown = realloc(extra, sizeof(dotsf_insn)*(capextra = capextra*2+DOTSF_LOOP_MAX_EMIT));
+            if (grown == NULL){ok = false; break;}
+            extra = grown;
         }
-        else if (*ip == '@')
+        if (nloops == caploops)
         {
-            if (!_dotsf_pop(interp, &v2)){return -23;}
-            else if (!_dotsf_pop(interp, &v1)){return -24;}
-            for (int i = 0; i < 4; i++){if (!_dotsf_push(interp, (i%2) ? (v2) : (v1))){return -(25+i);}}
+            size_t* grown = realloc(loops, sizeof(size_t)*2*(caploops = caploops*2+16));
+            if (grown == NULL){ok = false; break;}
+            loops = grown;
         }
-        else if (*ip == '?')
+        size_t used = _dotsf_loop_match(prog, target, pc, extra+nextra, vals);
+        if (used == 0){continue;}
+        loops[2*nloops] = prog->code[pc].arg;
+        loops[2*nloops+1] = nextra += used;
+        nloops++;
+    }
+    if (ok && nloops > 0)
+    {
+        size_t len = prog->len+nextra, out = 0, loop = 0;
+        code = malloc(sizeof(dotsf_insn)*len);
+        srcmap = malloc(sizeof(uint32_t)*len);
+        ok = code != NULL && srcmap != NULL;
+        for (size_t pc = 0; ok && pc < prog->len; pc++)
         {
-            char* ending;
-            if (!_dotsf_pop(interp, &v1)){return -30;}
-            if (!v1)
+            newpc[pc] = out; //jumps to a loop's label land on what was put in front of it.
+            if (loop < nloops && loops[2*loop] == pc)
             {
-                ip++;
-                for (rank1 = 1; ; ip++)
+                for (size_t e = (loop > 0) ? (loops[2*loop-1]) : (0); e < loops[2*loop+1]; e++)
                 {
-                    switch (*ip)
-                    {
-                        case '#':
-                            switch (*(++ip))
-                            {
-                                case 'c': ip+=2; break;
-                                default:
-                                    ending = strchr(ip, '\\');
-                                    if (ending == NULL){return -200;}
-                                    ip = ending;
-                                    break;
-                            }
-                            break;
-                        case '!':
-                            if ((ending = strpbrk(ip, "\r\n")) == NULL){return -201;}
-                            ip = ending;
-                            break;
-                        case '?': rank1++; break;
-                        case '|': rank1--; break;
-                        default: break;
-                    }
-                    if (rank1 == 0){break;}
+                    srcmap[out] = prog->srcmap[pc];
+                    code[out++] = extra[e];
                 }
+                loop++;
             }
-            else
-            {
-                ierank1++;
-            }
+            srcmap[out] = prog->srcmap[pc];
+            code[out++] = prog->code[pc];
         }
-        else if (*ip == '|' && ierank1 > 0)
+        if (ok)
         {
-            char* ending;
-            ierank1--;
-            ip++;
-            for (rank1 = 1; ; ip++)
-            {
-                switch(*ip)
-                {
-                    case '#':
-                        switch (*(++ip))
-                        {
-                            case 'c': ip+=2; break;
-                            default:
-                                ending = strchr(ip, '\\');
-                                if (ending == NULL){return -200;}
-                                ip = ending;
-                                break;
-                        }
-                        break;
-                    case '|': rank1++; break;
-                    case '\'': rank1--; break;
-                    case '!':
-                        if ((ending = strpbrk(ip, "\r\n")) == NULL){return -202;}
-                        ip = ending;
-                        break;
-                    default: break;
-                }
-                if (rank1 == 0){break;}
-            }
+            newpc[prog->len] = out;
+            for (size_t pc = 0; pc < out; pc++){if (_dotsf_is_jump(code[pc].op)){code[pc].arg = newpc[code[pc].arg];}}
+            free(prog->code);
+            free(prog->srcmap);
+            prog->code = code;
+            prog->srcmap = srcmap;
+            prog->len = prog->cap = out;
+            code = NULL;
+            srcmap = NULL;
         }
-        else if (*ip == '"')
+    }
+    free(code);
+    free(srcmap);
+    free(extra);
+    free(loops);
+    free(target);
+    free(newpc);
+    free(vals);
+    return ok;
+}
+/*
+    What LOOP, DRAIN and XFER do when they run, true when they did the whole loop and jump past it.
+*/
+bool _dotsf_loop(dotsf_interpreter* interp, const dotsf_insn* insn)
+{
+    const dotsf_insn* slots = insn+1;
+    dotsf_stack* stack = interp->stacks+interp->curstack;
+    bool grows = insn->err & DOTSF_LOOP_GROWS;
+    dotsf_int depth = (grows) ? (1) : (insn->len), delta = (grows) ? (insn->len-1) : (0);
+    if (stack->count < depth || ((insn->err & DOTSF_LOOP_PINNED) && stack->count != depth)){return false;}
+    //the counter has to reach 0 exactly, a loop that only ends once it wraps around is left to run.
+    int64_t count = *_dotsf_slot(stack, stack->count-1), step = slots[insn->len-1].arg, n, room;
+    if (count%step != 0 || (n = -count/step) < ((insn->err & DOTSF_LOOP_TEST_FIRST) ? (0) : (1))){return false;}
+    //the body's deepest point on the last time around, or the _ [ that ends the loop.
+    room = (n > 0) ? ((n-1)*delta+insn->arg2) : (1);
+    if (n*delta+1 > room){room = n*delta+1;}
+    if (room > INT_MAX || !_dotsf_reserve(stack, room)){return false;}
+    if (!grows)
+    {
+        for (dotsf_int i = 0; i < depth && n > 0; i++)
         {
-            while (true)
-            {
-                v1 = getchar();
-                if (v1 == EOF || v1 == '\r' || v1 == '\n'){break;}
-                if (!_dotsf_push(interp, v1)){return -31;}
-            }
-            if (!_dotsf_push(interp, 0)){return -32;}
+            dotsf_int* slot = _dotsf_slot(stack, stack->count-depth+i);
+            *slot = (slots[i].err) ? (slots[i].arg) : ((dotsf_int)((uint32_t)*slot+(uint32_t)n*(uint32_t)slots[i].arg));
         }
-        else if (*ip == '~'){if (!_dotsf_popb_pusht(interp, interp->curstack)){return -33;}}
-        else if (*ip == '#')
+        return true;
+    }
+    dotsf_int at = stack->count-1;
+    uint32_t counter = (uint32_t)count;
+    for (int64_t i = 0; i < n; i++, counter += (uint32_t)step)
+    {
+        for (dotsf_int e = 0; e < delta; e++){*_dotsf_slot(stack, at++) = (slots[e].err) ? (slots[e].arg) : ((dotsf_int)(counter+(uint32_t)slots[e].arg));}
+    }
+    *_dotsf_slot(stack, at) = 0;
+    stack->count = at+1;
+    return true;
+}
+bool _dotsf_drain(dotsf_stack* stack)
+{
+    for (dotsf_int i = stack->count-1; i >= 0; i--){if (*_dotsf_slot(stack, i) == 0){stack->count = i; return true;}}
+    return false; //the loop empties the stack and fails.
+}
+bool _dotsf_xfer(dotsf_interpreter* interp, const dotsf_insn* insn)
+{
+    dotsf_int other = insn->arg2, m = 0;
+    if (other < 0 || other >= DOTSF_MAX_STACKS || other == (dotsf_int)interp->curstack || !interp->stacks[other].in_use){return false;}
+    bool pull = insn->err & DOTSF_XFER_PULL;
+    dotsf_stack *stack = interp->stacks+interp->curstack, *src = (pull) ? (interp->stacks+other) : (stack), *dst = (pull) ? (stack) : (interp->stacks+other);
+    //every time around pushes the other stack's index and tests a copy of the top, the stack never gets deeper than that otherwise.
+    if (stack->count <= 0 || !_dotsf_reserve(stack, 1)){return false;}
+    if ((insn->err & DOTSF_LOOP_TEST_FIRST) && *_dotsf_slot(stack, stack->count-1) == 0){return true;}
+    //#stfc\ moves elements until the one left on top is a 0, and a loop that tests last moves the first one whatever it is.
+    //#stfa\ moves elements until it has moved a 0.
+    for (m = (pull || (insn->err & DOTSF_LOOP_TEST_FIRST)) ? (0) : (1); m < src->count && *_dotsf_slot(src, src->count-1-m) != 0; m++){}
+    if (m == src->count){return false;}
+    if (pull){m++;}
+    if (!_dotsf_reserve(dst, (pull) ? (m+1) : (m))){return false;}
+    _dotsf_copy_slots(dst, dst->count, src, src->count-m, m);
+    dst->count += m;
+    src->count -= m;
+    _dotsf_reverse_top(dst, m); //one at a time, the top element goes first.
+    return true;
+}
+bool dotsf_optimize(dotsf_program* prog) //false if memory ran out, prog still runs unoptimized then.
+{
+    bool* target = malloc(sizeof(bool)*(prog->len+1));
+    size_t* newpc = malloc(sizeof(size_t)*(prog->len+1));
+    if (target == NULL || newpc == NULL){free(target); free(newpc); return false;}
+    for (bool changed = true; changed; )
+    {
+        //fusions can enable each other (PUSHD PUSHD MUL becomes PUSHD MULK, then PUSHF), so repeat until nothing changes.
+        changed = false;
+        memset(target, 0, sizeof(bool)*(prog->len+1));
+        for (size_t pc = 0; pc < prog->len; pc++){if (_dotsf_is_jump(prog->code[pc].op)){target[prog->code[pc].arg] = true;}}
+        size_t out = 0;
+        for (size_t pc = 0; pc < prog->len; )
         {
-            ip++;
-            switch (*ip)
+            size_t n = 1, used;
+            while (n < 3 && pc+n < prog->len && !target[pc+n]){n++;}
+            dotsf_insn fused;
+            newpc[pc] = out;
+            prog->srcmap[out] = prog->srcmap[pc];
+            if ((used = _dotsf_fuse(prog->code+pc, n, &fused)) > 0){prog->code[out++] = fused; pc += used; changed = true;}
+            else {prog->code[out++] = prog->code[pc++];}
+        }
+        newpc[prog->len] = out;
+        for (size_t pc = 0; pc < out; pc++){if (_dotsf_is_jump(prog->code[pc].op)){prog->code[pc].arg = newpc[prog->code[pc].arg];}}
+        prog->len = out;
+    }
+    free(target);
+    free(newpc);
+    bool collapsed = _dotsf_loop_idioms(prog);
+    return _dotsf_guard_blocks(prog) && collapsed;
+}
+void _dotsf_line_col(const char* src, size_t off, size_t* line, size_t* col) //1-based position of src[off].
+{
+    *line = 1;
+    *col = 1;
+    for (size_t i = 0; i < off; i++){if (src[i] == '\n'){(*line)++; *col = 1;} else {(*col)++;}}
+}
+void dotsf_dump_program(const dotsf_program* prog, const char* src, FILE* out) //one instruction per line, with where it came from in src.
+{
+    for (size_t pc = 0; pc < prog->len; pc++)
+    {
+        const dotsf_insn* insn = prog->code+pc;
+        size_t line, col;
+        _dotsf_line_col(src, prog->srcmap[pc], &line, &col);
+        fprintf(out, "%6zu  %-8s %11i", pc, _dotsf_opnames[insn->op], insn->arg);
+        if (insn->err || insn->arg2){fprintf(out, " %11i %4i", insn->arg2, insn->err);}
+        else {fprintf(out, "%*s", 17, "");}
+        fprintf(out, "  ; %zu:%zu", line, col);
+        if (insn->op == DOTSF_OP_GUARD){fprintf(out, ", needs %i and room for %i over the next %u", insn->arg, insn->arg2, (unsigned)insn->len);}
+        if (insn->op == DOTSF_OP_LOOP){fprintf(out, ", the loop below in one go when the next %u describe it", (unsigned)insn->len);}
+        if (prog->snap != NULL && pc == prog->snap->start){fprintf(out, ", where runs start, on stack %u", (unsigned)prog->snap->curstack);}
+        fputc('\n', out);
+    }
+}
+void _dotsf_dump_stack(dotsf_interpreter* interp) //what ` prints.
+{
+    dotsf_stack* stack = interp->stacks+interp->curstack;
+    _dotsf_out_bytes(interp, "\nTHE CURRENT STACK IS:\n\n", sizeof("\nTHE CURRENT STACK IS:\n\n")-1);
+    for (dotsf_int sii = 0; sii < stack->count; sii++)
+    {
+        char line[32];
+        size_t len = _dotsf_format_int(line, sii);
+        memcpy(line+len, " = ", 3);
+        len += 3;
+        len += _dotsf_format_int(line+len, *_dotsf_slot(stack, sii));
+        line[len++] = '\n';
+        _dotsf_out_bytes(interp, line, len);
+    }
+    _dotsf_out_char(interp, '\n');
+    _dotsf_flush(interp);
+}
+#define DOTSF_ENGINE_NAME _dotsf_run_switch
+#define DOTSF_ENGINE_GOTO 0
+#define DOTSF_ENGINE_STEP 0
+#define DOTSF_ENGINE_PROFILE 0
+#define DOTSF_ENGINE_TRACE 0
+#define DOTSF_ENGINE_PREFIX 0
+#include "exdotsf_engine.inc"
+#undef DOTSF_ENGINE_NAME
+#undef DOTSF_ENGINE_GOTO
+#undef DOTSF_ENGINE_STEP
+#undef DOTSF_ENGINE_PROFILE
+#undef DOTSF_ENGINE_TRACE
+#undef DOTSF_ENGINE_PREFIX
+bool _dotsf_prefix_stop(dotsf_interpreter* interp, const dotsf_program* prog, size_t pc) //called by the prefix engine before every instruction.
+{
+    const dotsf_insn* insn = prog->code+pc;
+    bool stop = interp->prefix->steps-- == 0;
+    //END and FAIL too, so a run still ends (or fails) the way it would have without a snapshot.
+    for (size_t ui = 0; ui <= ((insn->op == DOTSF_OP_GUARD) ? (insn->len) : (0u)) && !stop; ui++)
+    {
+        switch (insn[ui].op)
+        {
+            case DOTSF_OP_READI: case DOTSF_OP_READC: case DOTSF_OP_READL: case DOTSF_OP_DUMP:
+            case DOTSF_OP_PRINTI: case DOTSF_OP_PRINTC: case DOTSF_OP_PRINTIK: case DOTSF_OP_PRINTCK:
+            case DOTSF_OP_END: case DOTSF_OP_FAIL: stop = true; break;
+            default: break;
+        }
+    }
+    if (stop){interp->prefix->pc = pc;}
+    return stop;
+}
+#define DOTSF_ENGINE_NAME _dotsf_run_prefix
+#define DOTSF_ENGINE_GOTO 0
+#define DOTSF_ENGINE_STEP 0
+#define DOTSF_ENGINE_PROFILE 0
+#define DOTSF_ENGINE_TRACE 0
+#define DOTSF_ENGINE_PREFIX 1
+#include "exdotsf_engine.inc"
+#undef DOTSF_ENGINE_NAME
+#undef DOTSF_ENGINE_GOTO
+#undef DOTSF_ENGINE_STEP
+#undef DOTSF_ENGINE_PROFILE
+#undef DOTSF_ENGINE_TRACE
+#undef DOTSF_ENGINE_PREFIX
+#if DOTSF_HAVE_THREADED
+#define DOTSF_ENGINE_NAME _dotsf_run_threaded
+#define DOTSF_ENGINE_GOTO 1
+#define DOTSF_ENGINE_STEP 0
+#define DOTSF_ENGINE_PROFILE 0
+#define DOTSF_ENGINE_TRACE 0
+#define DOTSF_ENGINE_PREFIX 0
+#include "exdotsf_engine.inc"
+#undef DOTSF_ENGINE_NAME
+#undef DOTSF_ENGINE_GOTO
+#undef DOTSF_ENGINE_STEP
+#undef DOTSF_ENGINE_PROFILE
+#undef DOTSF_ENGINE_TRACE
+#undef DOTSF_ENGINE_PREFIX
+#endif
+#if DOTSF_HAVE_PROFILE
+void _dotsf_profile_insn(dotsf_interpreter* interp, size_t pc) //called by the profiling engine before every instruction.
+{
+    dotsf_profile* prof = interp->profile;
+    prof->counts[pc]++;
+    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++)
+    {
+        if (interp->stacks[si].count > prof->highwater[si]){prof->highwater[si] = interp->stacks[si].count;}
+    }
+}
+#define DOTSF_ENGINE_NAME _dotsf_run_profile
+#define DOTSF_ENGINE_GOTO 0
+#define DOTSF_ENGINE_STEP 0
+#define DOTSF_ENGINE_PROFILE 1
+#define DOTSF_ENGINE_TRACE 0
+#define DOTSF_ENGINE_PREFIX 0
+#include "exdotsf_engine.inc"
+#undef DOTSF_ENGINE_NAME
+#undef DOTSF_ENGINE_GOTO
+#undef DOTSF_ENGINE_STEP
+#undef DOTSF_ENGINE_PROFILE
+#undef DOTSF_ENGINE_TRACE
+#undef DOTSF_ENGINE_PREFIX
+#endif
+#if DOTSF_HAVE_TRACE
+void _dotsf_trace_insn(dotsf_interpreter* interp, const dotsf_program* prog, size_t pc) //called by the tracing engine before every instruction.
+{
+    dotsf_trace* trace = interp->trace;
+    dotsf_stack* stack = interp->stacks+interp->curstack;
+    uint64_t step = trace->steps;
+    volatile dotsf_trace_entry* entry = trace->ring+(step & trace->mask); //volatile keeps the stores ahead of the count.
+    entry->pc = pc;
+    entry->srcoff = prog->srcmap[pc];
+    entry->top = (stack->count > 0) ? (*_dotsf_slot(stack, stack->count-1)) : (0);
+    entry->op = prog->code[pc].op;
+    entry->stack = interp->curstack;
+    entry->empty = stack->count <= 0;
+    trace->steps = step+1;
+}
+#define DOTSF_ENGINE_NAME _dotsf_run_trace
+#define DOTSF_ENGINE_GOTO DOTSF_HAVE_THREADED
+#define DOTSF_ENGINE_STEP 0
+#define DOTSF_ENGINE_PROFILE 0
+#define DOTSF_ENGINE_TRACE 1
+#define DOTSF_ENGINE_PREFIX 0
+#include "exdotsf_engine.inc"
+#undef DOTSF_ENGINE_NAME
+#undef DOTSF_ENGINE_GOTO
+#undef DOTSF_ENGINE_STEP
+#undef DOTSF_ENGINE_PROFILE
+#undef DOTSF_ENGINE_TRACE
+#undef DOTSF_ENGINE_PREFIX
+#endif
+#if DOTSF_HAVE_JIT
+#define DOTSF_ENGINE_NAME _dotsf_step
+#define DOTSF_ENGINE_GOTO 0
+#define DOTSF_ENGINE_STEP 1
+#define DOTSF_ENGINE_PROFILE 0
+#define DOTSF_ENGINE_TRACE 0
+#define DOTSF_ENGINE_PREFIX 0
+#include "exdotsf_engine.inc"
+#undef DOTSF_ENGINE_NAME
+#undef DOTSF_ENGINE_GOTO
+#undef DOTSF_ENGINE_STEP
+#undef DOTSF_ENGINE_PROFILE
+#undef DOTSF_ENGINE_TRACE
+#undef DOTSF_ENGINE_PREFIX
+/*
+    The x86-64 JIT. Generated code keeps the current stack in callee saved registers while it runs:
+        rbx = interp, r12 = the current dotsf_stack, r13 = its buffer, r14d = index of the top slot, r15d = count, ebp = cap.
+    Only count is ever written back (head doesn't move when the top is pushed or popped), so spilling is one store.
+    Pushes, pops, arithmetic, comparisons, _, @, ~ and jumps are translated inline, and : and ; call the output functions
+    directly. LOOP, DRAIN and XFER call _dotsf_loop, _dotsf_drain and _dotsf_xfer between a spill and a reload and jump
+    past their loop when those did it all. Everything else spills, calls _dotsf_step for that one instruction and reloads,
+    since any of those may switch, grow or delete stacks.
+    The code only refers to itself with rel32 offsets and to C with absolute addresses, so it is built in a malloc'd
+    buffer and copied into its executable mapping at the end.
+*/
+typedef struct {
+    unsigned char* code;
+    size_t len, cap;
+    bool failed;
+} dotsf_jitbuf;
+void _dotsf_jit_bytes(dotsf_jitbuf* jit, const void* bytes, size_t count)
+{
+    if (jit->failed){return;}
+    if (jit->cap-jit->len < count)
+    {
+        size_t newcap = (jit->cap) ? (jit->cap*2) : (4096);
+        while (newcap-jit->len < count){newcap *= 2;}
+        unsigned char* grown = realloc(jit->code, newcap);
+        if (grown == NULL){jit->failed = true; return;}
+        jit->code = grown;
+        jit->cap = newcap;
+    }
+    memcpy(jit->code+jit->len, bytes, count);
+    jit->len += count;
+}
+#define _dotsf_jit_emit(jit, ...) _dotsf_jit_bytes(jit, (const unsigned char[]){__VA_ARGS__}, sizeof((const unsigned char[]){__VA_ARGS__}))
+void _dotsf_jit_u32(dotsf_jitbuf* jit, uint32_t v){_dotsf_jit_bytes(jit, &v, 4);}
+void _dotsf_jit_u64(dotsf_jitbuf* jit, uint64_t v){_dotsf_jit_bytes(jit, &v, 8);}
+void _dotsf_jit_rel32(dotsf_jitbuf* jit, size_t target) //the rel32 operand of a jump or call to an offset that has already been emitted.
+{
+    _dotsf_jit_u32(jit, (uint32_t)(target-(jit->len+4)));
+}
+void _dotsf_jit_patch8(dotsf_jitbuf* jit, size_t after) //points the rel8 jump that ends at after to the current offset.
+{
+    if (!jit->failed){jit->code[after-1] = (unsigned char)(jit->len-after);}
+}
+void _dotsf_jit_call_c(dotsf_jitbuf* jit, const void* fn) //mov rax, fn; call rax. the caller keeps rsp 16 byte aligned.
+{
+    _dotsf_jit_emit(jit, 0x48, 0xB8);
+    _dotsf_jit_u64(jit, (uint64_t)(uintptr_t)fn);
+    _dotsf_jit_emit(jit, 0xFF, 0xD0);
+}
+void _dotsf_jit_spill(dotsf_jitbuf* jit) //mov [r12+count], r15d
+{
+    _dotsf_jit_emit(jit, 0x45, 0x89, 0xBC, 0x24);
+    _dotsf_jit_u32(jit, offsetof(dotsf_stack, count));
+}
+bool dotsf_jit_compile(dotsf_program* prog)
+{
+    dotsf_jitbuf jit = { };
+    size_t* native = malloc(sizeof(size_t)*(prog->len+1)); //native offset of every instruction.
+    size_t* fixups = malloc(sizeof(size_t)*(prog->len+1)); //rel32 operands of jumps to instructions, patched once all offsets are known.
+    size_t nfixups = 0, after;
+    if (native == NULL || fixups == NULL){free(native); free(fixups); return false;}
+
+    //exit_spill: spill, then return eax. exit: return eax.
+    size_t exit_spill = jit.len;
+    _dotsf_jit_spill(&jit);
+    _dotsf_jit_emit(&jit, 0x48, 0x83, 0xC4, 0x08, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B, 0xC3); //add rsp, 8; pop r15-r12, rbp, rbx; ret
+    //reload: loads the registers from interp->stacks[interp->curstack], clobbers ecx only.
+    size_t reload = jit.len;
+    _dotsf_jit_emit(&jit, 0x8B, 0x8B); //mov ecx, [rbx+curstack]
+    _dotsf_jit_u32(&jit, offsetof(dotsf_interpreter, curstack));
+    _dotsf_jit_emit(&jit, 0x69, 0xC9); //imul ecx, ecx, sizeof(dotsf_stack)
+    _dotsf_jit_u32(&jit, sizeof(dotsf_stack));
+    _dotsf_jit_emit(&jit, 0x4C, 0x8D, 0xA4, 0x0B); //lea r12, [rbx+rcx+stacks]
+    _dotsf_jit_u32(&jit, offsetof(dotsf_interpreter, stacks));
+    _dotsf_jit_emit(&jit, 0x4D, 0x8B, 0xAC, 0x24); //mov r13, [r12+stack]
+    _dotsf_jit_u32(&jit, offsetof(dotsf_stack, stack));
+    _dotsf_jit_emit(&jit, 0x41, 0x8B, 0xAC, 0x24); //mov ebp, [r12+cap]
+    _dotsf_jit_u32(&jit, offsetof(dotsf_stack, cap));
+    _dotsf_jit_emit(&jit, 0x45, 0x8B, 0xBC, 0x24); //mov r15d, [r12+count]
+    _dotsf_jit_u32(&jit, offsetof(dotsf_stack, count));
+    _dotsf_jit_emit(&jit, 0x45, 0x8B, 0xB4, 0x24); //mov r14d, [r12+head]
+    _dotsf_jit_u32(&jit, offsetof(dotsf_stack, head));
+    _dotsf_jit_emit(&jit, 0x45, 0x01, 0xFE, 0x41, 0xFF, 0xCE); //add r14d, r15d; dec r14d
+    _dotsf_jit_emit(&jit, 0x79, 0x00); //jns
+    after = jit.len;
+    _dotsf_jit_emit(&jit, 0x44, 0x8D, 0x75, 0xFF, 0xC3); //lea r14d, [rbp-1]; ret
+    _dotsf_jit_patch8(&jit, after);
+    _dotsf_jit_emit(&jit, 0x41, 0x39, 0xEE, 0x7C, 0x00); //cmp r14d, ebp; jl
+    after = jit.len;
+    _dotsf_jit_emit(&jit, 0x41, 0x29, 0xEE); //sub r14d, ebp
+    _dotsf_jit_patch8(&jit, after);
+    _dotsf_jit_emit(&jit, 0xC3); //ret
+    //step: runs the instruction at edx with _dotsf_step, eax = its result.
+    size_t step = jit.len;
+    _dotsf_jit_spill(&jit);
+    _dotsf_jit_emit(&jit, 0x48, 0x89, 0xDF, 0x48, 0x8B, 0x74, 0x24, 0x08, 0x48, 0x83, 0xEC, 0x08); //mov rdi, rbx; mov rsi, [rsp+8] (prog); sub rsp, 8
+    _dotsf_jit_call_c(&jit, (const void*)_dotsf_step);
+    _dotsf_jit_emit(&jit, 0x48, 0x83, 0xC4, 0x08, 0xE8); //add rsp, 8; call reload
+    _dotsf_jit_rel32(&jit, reload);
+    _dotsf_jit_emit(&jit, 0xC3);
+    //push_slow: pushes eax with _dotsf_push when the stack is full, eax = whether it succeeded.
+    size_t push_slow = jit.len;
+    _dotsf_jit_spill(&jit);
+    _dotsf_jit_emit(&jit, 0x48, 0x89, 0xDF, 0x89, 0xC6, 0x48, 0x83, 0xEC, 0x08); //mov rdi, rbx; mov esi, eax; sub rsp, 8
+    _dotsf_jit_call_c(&jit, (const void*)_dotsf_push);
+    _dotsf_jit_emit(&jit, 0x48, 0x83, 0xC4, 0x08, 0x0F, 0xB6, 0xC0, 0xE8); //add rsp, 8; movzx eax, al; call reload
+    _dotsf_jit_rel32(&jit, reload);
+    _dotsf_jit_emit(&jit, 0xC3);
+    //binerr: a binary operator found fewer than 2 elements, -14 if there were none or -15 after popping the only one.
+    size_t binerr = jit.len;
+    _dotsf_jit_emit(&jit, 0x45, 0x85, 0xFF, 0xB8); //test r15d, r15d; mov eax, -14
+    _dotsf_jit_u32(&jit, (uint32_t)-14);
+    _dotsf_jit_emit(&jit, 0x0F, 0x84); //jz exit_spill
+    _dotsf_jit_rel32(&jit, exit_spill);
+    _dotsf_jit_emit(&jit, 0x45, 0x31, 0xFF, 0xB8); //xor r15d, r15d; mov eax, -15
+    _dotsf_jit_u32(&jit, (uint32_t)-15);
+    _dotsf_jit_emit(&jit, 0xE9);
+    _dotsf_jit_rel32(&jit, exit_spill);
+    //diverr: a / that _dotsf_div_traps, which idiv would have raised SIGFPE for.
+    size_t diverr = jit.len;
+    _dotsf_jit_emit(&jit, 0xB8);
+    _dotsf_jit_u32(&jit, (uint32_t)-133);
+    _dotsf_jit_emit(&jit, 0xE9);
+    _dotsf_jit_rel32(&jit, exit_spill);
+
+    //the entry point, int (dotsf_interpreter* interp, const dotsf_program* prog), keeps prog at [rsp].
+    size_t entry = jit.len;
+    _dotsf_jit_emit(&jit, 0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57); //push rbx, rbp, r12-r15
+    _dotsf_jit_emit(&jit, 0x48, 0x83, 0xEC, 0x08, 0x48, 0x89, 0x34, 0x24, 0x48, 0x89, 0xFB, 0xE8); //sub rsp, 8; mov [rsp], rsi; mov rbx, rdi; call reload
+    _dotsf_jit_rel32(&jit, reload);
+    #define _dotsf_jit_fail_if(jcc, status) /* jcc exit_spill with eax = status */ \
+        _dotsf_jit_emit(&jit, 0xB8); _dotsf_jit_u32(&jit, (uint32_t)(status)); \
+        _dotsf_jit_emit(&jit, 0x0F, jcc); _dotsf_jit_rel32(&jit, exit_spill);
+    #define _dotsf_jit_push(status) /* pushes eax */ \
+        _dotsf_jit_emit(&jit, 0x41, 0x39, 0xEF, 0x7C, 0x00); /* cmp r15d, ebp; jl fast */ \
+        after = jit.len; \
+        _dotsf_jit_emit(&jit, 0xE8); _dotsf_jit_rel32(&jit, push_slow); \
+        _dotsf_jit_emit(&jit, 0x85, 0xC0); /* test eax, eax */ \
+        _dotsf_jit_fail_if(0x84, status) \
+        _dotsf_jit_emit(&jit, 0xEB, 0x00); /* jmp done */ \
+        _dotsf_jit_patch8(&jit, after); \
+        after = jit.len; \
+        _dotsf_jit_emit(&jit, 0x41, 0xFF, 0xC6, 0x41, 0x39, 0xEE, 0x7C, 0x03, 0x45, 0x31, 0xF6); /* inc r14d; cmp r14d, ebp; jl +3; xor r14d, r14d */ \
+        _dotsf_jit_emit(&jit, 0x43, 0x89, 0x44, 0xB5, 0x00, 0x41, 0xFF, 0xC7); /* mov [r13+r14*4], eax; inc r15d */ \
+        _dotsf_jit_patch8(&jit, after);
+    #define _dotsf_jit_pop(modrm) /* pops into eax (0x44) or ecx (0x4C) */ \
+        _dotsf_jit_emit(&jit, 0x43, 0x8B, modrm, 0xB5, 0x00, 0x41, 0xFF, 0xCE, 0x79, 0x04, 0x44, 0x8D, 0x75, 0xFF, 0x41, 0xFF, 0xCF);
+    #define _dotsf_jit_binop(...) /* eax = v1, ecx = v2, the result replaces v1 */ \
+        _dotsf_jit_emit(&jit, 0x41, 0x83, 0xFF, 0x02, 0x0F, 0x8C); _dotsf_jit_rel32(&jit, binerr); /* cmp r15d, 2; jl binerr */ \
+        _dotsf_jit_pop(0x4C) \
+        _dotsf_jit_emit(&jit, 0x43, 0x8B, 0x44, 0xB5, 0x00, __VA_ARGS__, 0x43, 0x89, 0x44, 0xB5, 0x00); \
+        break;
+    #define _dotsf_jit_cmpop(setcc) _dotsf_jit_binop(0x39, 0xC8, 0x0F, setcc, 0xC0, 0x0F, 0xB6, 0xC0) /* cmp eax, ecx; setcc al; movzx eax, al */
+    for (size_t pc = 0; pc < prog->len; pc++)
+    {
+        const dotsf_insn* insn = prog->code+pc;
+        native[pc] = jit.len;
+        if (insn->op >= DOTSF_OP_ADDK && insn->op < DOTSF_OP_LOOP){jit.failed = true; break;} //superinstructions are left to the interpreter.
+        switch (insn->op)
+        {
+            case DOTSF_OP_END: _dotsf_jit_emit(&jit, 0x31, 0xC0, 0xE9); _dotsf_jit_rel32(&jit, exit_spill); break;
+            case DOTSF_OP_FAIL:
+                _dotsf_jit_emit(&jit, 0xB8); _dotsf_jit_u32(&jit, insn->arg);
+                _dotsf_jit_emit(&jit, 0xE9); _dotsf_jit_rel32(&jit, exit_spill);
+                break;
+            case DOTSF_OP_JMP: case DOTSF_OP_ELSE:
+                _dotsf_jit_emit(&jit, 0xE9);
+                _dotsf_jit_u32(&jit, insn->arg);
+                fixups[nfixups++] = jit.len;
+                break;
+            case DOTSF_OP_IFZ: case DOTSF_OP_IF:
+                _dotsf_jit_emit(&jit, 0x45, 0x85, 0xFF); //test r15d, r15d
+                _dotsf_jit_fail_if(0x84, (insn->op == DOTSF_OP_IF) ? (-30) : (-10))
+                _dotsf_jit_pop(0x44)
+                _dotsf_jit_emit(&jit, 0x85, 0xC0, 0x0F, 0x84); //test eax, eax; jz target
+                _dotsf_jit_u32(&jit, insn->arg);
+                fixups[nfixups++] = jit.len;
+                break;
+            case DOTSF_OP_PUSHD: case DOTSF_OP_PUSHC: case DOTSF_OP_PUSHN:
+                _dotsf_jit_emit(&jit, 0xB8); _dotsf_jit_u32(&jit, insn->arg);
+                _dotsf_jit_push((insn->op == DOTSF_OP_PUSHD) ? (-13) : ((insn->op == DOTSF_OP_PUSHC) ? (-52) : (-54)))
+                break;
+            case DOTSF_OP_DUP:
+                _dotsf_jit_emit(&jit, 0x45, 0x85, 0xFF); //test r15d, r15d
+                _dotsf_jit_fail_if(0x84, -20)
+                _dotsf_jit_emit(&jit, 0x43, 0x8B, 0x44, 0xB5, 0x00); //mov eax, [r13+r14*4]
+                _dotsf_jit_push(-22)
+                break;
+            case DOTSF_OP_ADD: _dotsf_jit_binop(0x01, 0xC8) //add eax, ecx
+            case DOTSF_OP_SUB: _dotsf_jit_binop(0x29, 0xC8) //sub eax, ecx
+            case DOTSF_OP_MUL: _dotsf_jit_binop(0x0F, 0xAF, 0xC1) //imul eax, ecx
+            case DOTSF_OP_DIV:
+                _dotsf_jit_emit(&jit, 0x41, 0x83, 0xFF, 0x02, 0x0F, 0x8C); _dotsf_jit_rel32(&jit, binerr); //cmp r15d, 2; jl binerr
+                _dotsf_jit_pop(0x4C)
+                _dotsf_jit_emit(&jit, 0x43, 0x8B, 0x44, 0xB5, 0x00, 0x85, 0xC9, 0x0F, 0x84); //mov eax, [r13+r14*4]; test ecx, ecx; jz diverr
+                _dotsf_jit_rel32(&jit, diverr);
+                _dotsf_jit_emit(&jit, 0x83, 0xF9, 0xFF, 0x75, 0x0B, 0x3D, 0x00, 0x00, 0x00, 0x80, 0x0F, 0x84); //cmp ecx, -1; jne +11; cmp eax, INT_MIN; je diverr
+                _dotsf_jit_rel32(&jit, diverr);
+                _dotsf_jit_emit(&jit, 0x99, 0xF7, 0xF9, 0x43, 0x89, 0x44, 0xB5, 0x00); //cdq; idiv ecx; mov [r13+r14*4], eax
+                break;
+            /*
+                _dotsf_modulus: by 0 the dividend stays, by -1 it becomes its sign (so idiv never sees INT_MIN / -1),
+                otherwise the remainder idiv leaves in edx plus the divisor when the dividend is negative.
+            */
+            case DOTSF_OP_MOD: _dotsf_jit_binop(0x85, 0xC9, 0x74, 0x18, 0x83, 0xF9, 0xFF, 0x75, 0x05, 0xC1, 0xF8, 0x1F, 0xEB, 0x0E, //test ecx, ecx; jz +24; cmp ecx, -1; jne +5; sar eax, 31; jmp +14
+                0x89, 0xC6, 0x99, 0xF7, 0xF9, 0x89, 0xD0, 0xC1, 0xFE, 0x1F, 0x21, 0xCE, 0x01, 0xF0) //mov esi, eax; cdq; idiv ecx; mov eax, edx; sar esi, 31; and esi, ecx; add eax, esi
+            case DOTSF_OP_DUP2: //pushes the second element and then the one that was on top, which is second by then.
+                _dotsf_jit_emit(&jit, 0x45, 0x85, 0xFF); //test r15d, r15d
+                _dotsf_jit_fail_if(0x84, -23)
+                _dotsf_jit_emit(&jit, 0x41, 0x83, 0xFF, 0x01); //cmp r15d, 1
+                _dotsf_jit_fail_if(0x84, -24)
+                for (int i = 0; i < 2; i++)
+                {
+                    _dotsf_jit_emit(&jit, 0x44, 0x89, 0xF1, 0xFF, 0xC9, 0x79, 0x02, 0x01, 0xE9); //mov ecx, r14d; dec ecx; jns +2; add ecx, ebp
+                    _dotsf_jit_emit(&jit, 0x41, 0x8B, 0x44, 0x8D, 0x00); //mov eax, [r13+rcx*4]
+                    _dotsf_jit_push(-27-i)
+                }
+                break;
+            case DOTSF_OP_ROT: //the bottom element moves into the slot above the top, head moves up past it.
+                _dotsf_jit_emit(&jit, 0x45, 0x85, 0xFF); //test r15d, r15d
+                _dotsf_jit_fail_if(0x84, -33)
+                _dotsf_jit_emit(&jit, 0x41, 0x8B, 0x8C, 0x24); //mov ecx, [r12+head]
+                _dotsf_jit_u32(&jit, offsetof(dotsf_stack, head));
+                _dotsf_jit_emit(&jit, 0x41, 0x8B, 0x44, 0x8D, 0x00, 0xFF, 0xC1, 0x39, 0xE9, 0x7C, 0x02, 0x31, 0xC9); //mov eax, [r13+rcx*4]; inc ecx; cmp ecx, ebp; jl +2; xor ecx, ecx
+                _dotsf_jit_emit(&jit, 0x41, 0x89, 0x8C, 0x24); //mov [r12+head], ecx
+                _dotsf_jit_u32(&jit, offsetof(dotsf_stack, head));
+                _dotsf_jit_emit(&jit, 0x41, 0xFF, 0xC6, 0x41, 0x39, 0xEE, 0x7C, 0x03, 0x45, 0x31, 0xF6); //inc r14d; cmp r14d, ebp; jl +3; xor r14d, r14d
+                _dotsf_jit_emit(&jit, 0x43, 0x89, 0x44, 0xB5, 0x00); //mov [r13+r14*4], eax
+                break;
+            case DOTSF_OP_PRINTI: case DOTSF_OP_PRINTC: //output never touches the stacks, so nothing is spilled or reloaded around it.
+                _dotsf_jit_emit(&jit, 0x45, 0x85, 0xFF); //test r15d, r15d
+                _dotsf_jit_fail_if(0x84, -10)
+                _dotsf_jit_pop(0x44)
+                _dotsf_jit_emit(&jit, 0x48, 0x89, 0xDF, 0x89, 0xC6); //mov rdi, rbx; mov esi, eax
+                _dotsf_jit_call_c(&jit, (insn->op == DOTSF_OP_PRINTI) ? ((const void*)_dotsf_out_int) : ((const void*)_dotsf_out_char));
+                break;
+            case DOTSF_OP_AND: _dotsf_jit_binop(0x85, 0xC0, 0x0F, 0x95, 0xC0, 0x85, 0xC9, 0x0F, 0x95, 0xC1, 0x20, 0xC8, 0x0F, 0xB6, 0xC0) //eax = (eax != 0) & (ecx != 0)
+            case DOTSF_OP_EQ: _dotsf_jit_cmpop(0x94)
+            case DOTSF_OP_GT: _dotsf_jit_cmpop(0x9F)
+            case DOTSF_OP_LT: _dotsf_jit_cmpop(0x9C)
+            case DOTSF_OP_LE: _dotsf_jit_cmpop(0x9E)
+            case DOTSF_OP_GE: _dotsf_jit_cmpop(0x9D)
+            //collapsed loops call what the interpreter runs for them and jump past the loop when that did it all.
+            case DOTSF_OP_LOOP: case DOTSF_OP_XFER: case DOTSF_OP_DRAIN:
+                _dotsf_jit_spill(&jit);
+                if (insn->op == DOTSF_OP_DRAIN){_dotsf_jit_emit(&jit, 0x4C, 0x89, 0xE7);} //mov rdi, r12
+                else //mov rdi, rbx; mov rsi, insn
+                {
+                    _dotsf_jit_emit(&jit, 0x48, 0x89, 0xDF, 0x48, 0xBE);
+                    _dotsf_jit_u64(&jit, (uint64_t)(uintptr_t)insn);
+                }
+                _dotsf_jit_call_c(&jit, (insn->op == DOTSF_OP_LOOP) ? ((const void*)_dotsf_loop) : ((insn->op == DOTSF_OP_XFER) ? ((const void*)_dotsf_xfer) : ((const void*)_dotsf_drain)));
+                _dotsf_jit_emit(&jit, 0xE8); _dotsf_jit_rel32(&jit, reload);
+                _dotsf_jit_emit(&jit, 0x84, 0xC0, 0x0F, 0x85); //test al, al; jnz target
+                _dotsf_jit_u32(&jit, insn->arg);
+                fixups[nfixups++] = jit.len;
+                break;
+            case DOTSF_OP_LSLOT: break; //only read by the LOOP in front of it, which falls through past them to the loop as written.
+            default: //mov edx, pc; call step; cmp eax, 1; jne exit_spill
+                _dotsf_jit_emit(&jit, 0xBA); _dotsf_jit_u32(&jit, pc);
+                _dotsf_jit_emit(&jit, 0xE8); _dotsf_jit_rel32(&jit, step);
+                _dotsf_jit_emit(&jit, 0x83, 0xF8, 0x01, 0x0F, 0x85); _dotsf_jit_rel32(&jit, exit_spill);
+                break;
+        }
+    }
+    native[prog->len] = jit.len;
+    #undef _dotsf_jit_fail_if
+    #undef _dotsf_jit_push
+    #undef _dotsf_jit_pop
+    #undef _dotsf_jit_binop
+    #undef _dotsf_jit_cmpop
+    //every jump was emitted with the instruction index it goes to in place of its rel32.
+    for (size_t fi = 0; fi < nfixups && !jit.failed; fi++)
+    {
+        uint32_t target;
+        memcpy(&target, jit.code+fixups[fi]-4, 4);
+        target = (uint32_t)(native[target]-fixups[fi]);
+        memcpy(jit.code+fixups[fi]-4, &target, 4);
+    }
+    free(native);
+    free(fixups);
+    void* mem = MAP_FAILED;
+    if (!jit.failed){mem = mmap(NULL, jit.len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);}
+    if (mem != MAP_FAILED)
+    {
+        memcpy(mem, jit.code, jit.len);
+        if (mprotect(mem, jit.len, PROT_READ|PROT_EXEC) != 0){munmap(mem, jit.len); mem = MAP_FAILED;}
+    }
+    free(jit.code);
+    if (mem == MAP_FAILED){return false;}
+    if (prog->jitcode != NULL){munmap(prog->jitcode, prog->jitsize);}
+    prog->jitcode = mem;
+    prog->jitsize = jit.len;
+    prog->jitentry = (int (*)(dotsf_interpreter*, const dotsf_program*))(void*)((unsigned char*)mem+entry);
+    return true;
+}
+#else
+bool dotsf_jit_compile(dotsf_program* prog) //there is no JIT for this platform, dotsf_run interprets the program instead.
+{
+    (void)prog;
+    return false;
+}
+#endif
+void _dotsf_reset_stacks(dotsf_interpreter* interp) //leaves only an empty stack 0, the state every program starts in.
+{
+    dotsf_int _snum1;
+    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++)
+    {
+        _dotsf_delete_stack(interp, si);
+    }
+    interp->curstack = 0; //the last run may have ended on another stack.
+    _dotsf_create_stack(interp, 0, DOTSF_MAX_STACK_SIZE, NULL);
+    _dotsf_pop(interp, &_snum1);
+}
+bool _dotsf_restore(dotsf_interpreter* interp, const dotsf_snapshot* snap) //puts every stack back the way snap has it, false when out of memory.
+{
+    const dotsf_int* data = snap->data;
+    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++){_dotsf_delete_stack(interp, si);}
+    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++)
+    {
+        dotsf_stack* stack = interp->stacks+si;
+        if (!snap->inuse[si]){continue;}
+        interp->curstack = si; //_dotsf_create_stack pushes the new stack's number onto the current one, so onto itself here.
+        _dotsf_create_stack(interp, si, snap->maxstack[si], NULL);
+        _dotsf_clear_stack(stack);
+        if (snap->count[si] <= 0){continue;}
+        if (!_dotsf_reserve(stack, snap->count[si])){return false;}
+        memcpy(stack->stack, data, sizeof(dotsf_int)*snap->count[si]);
+        stack->count = snap->count[si];
+        data += snap->count[si];
+    }
+    interp->curstack = snap->curstack;
+    return true;
+}
+int dotsf_run(dotsf_interpreter* interp, const dotsf_program* prog)
+{
+    if (prog->snap == NULL){_dotsf_reset_stacks(interp);}
+    else if (!_dotsf_restore(interp, prog->snap)){return -400;}
+    int status;
+    #if DOTSF_HAVE_PROFILE
+    if (interp->profile != NULL){status = _dotsf_run_profile(interp, prog);}
+    else
+    #endif
+    #if DOTSF_HAVE_TRACE
+    if (interp->trace != NULL){status = _dotsf_run_trace(interp, prog);}
+    else
+    #endif
+    #if DOTSF_HAVE_JIT
+    if ((interp->engine == DOTSF_ENGINE_JIT || interp->engine == DOTSF_ENGINE_AUTO) && prog->jitentry != NULL && prog->snap == NULL){status = prog->jitentry(interp, prog);}
+    else
+    #endif
+    #if DOTSF_HAVE_THREADED
+    if (interp->engine != DOTSF_ENGINE_SWITCH){status = _dotsf_run_threaded(interp, prog);}
+    else
+    #endif
+    {status = _dotsf_run_switch(interp, prog);}
+    _dotsf_flush(interp);
+    return status;
+}
+/*
+    The library interface from exdotsf.h. An interpreter owns its stacks, I/O buffers and dotsf_io, a program owns
+    its instructions (and native code), and nothing else is shared, so each interpreter can run on its own thread.
+*/
+void _dotsf_drop_input(dotsf_interpreter* interp) //forgets input read ahead, and unmaps stdin if _dotsf_map_stdin mapped it.
+{
+    dotsf_inbuf* in = &interp->in;
+    #if DOTSF_HAVE_MMAP
+    if (in->mapped){munmap((void*)in->data, in->len);}
+    #endif
+    in->data = in->own;
+    in->pos = in->len = 0;
+    in->mapped = false;
+}
+void dotsf_set_io(dotsf_interpreter* interp, const dotsf_io* io)
+{
+    static const dotsf_io stdio = {.read=_dotsf_std_read, .write=_dotsf_std_write};
+    _dotsf_drop_input(interp);
+    interp->io = (io != NULL) ? (*io) : (stdio);
+}
+dotsf_interpreter* dotsf_create(const dotsf_io* io)
+{
+    dotsf_interpreter* interp = calloc(1, sizeof(dotsf_interpreter));
+    if (interp != NULL){dotsf_set_io(interp, io);}
+    return interp;
+}
+void dotsf_destroy(dotsf_interpreter* interp)
+{
+    if (interp == NULL){return;}
+    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++){_dotsf_delete_stack(interp, si);}
+    while (interp->nspares > 0){free(interp->spares[--(interp->nspares)].stack);}
+    _dotsf_drop_input(interp);
+    free(interp);
+}
+void dotsf_set_engine(dotsf_interpreter* interp, dotsf_engine engine)
+{
+    interp->engine = engine;
+}
+void dotsf_set_line_buffered(dotsf_interpreter* interp, bool linebuffered)
+{
+    interp->out.linebuffered = linebuffered;
+}
+typedef struct dotsf_load_stats //what --load-stats prints, nanoseconds.
+{
+    uint64_t compile, optimize, preeval;
+    size_t bytes;
+    bool loaded; //false when the program came out of the cache.
+} dotsf_load_stats;
+/*
+    DOTSF_LOAD_PREEVAL (--preeval) runs the start of the program once at load time: everything up to the first instruction
+    that reads or writes, or the first steps instructions when it gets that far without any. Until then a run can't do anything
+    but what this one did, so the stacks it leaves are kept in a dotsf_snapshot and every run copies them back and goes on from there.
+    A prefix that fails is left for the runs to fail in, and a --cache file keeps the snapshot along with the instructions.
+*/
+void _dotsf_preeval(dotsf_program* prog, uint64_t steps)
+{
+    dotsf_prefix prefix = {.steps=steps};
+    dotsf_interpreter* interp = dotsf_create(NULL); //never reads or writes, see _dotsf_prefix_stop.
+    if (interp == NULL){return;}
+    interp->prefix = &prefix;
+    _dotsf_reset_stacks(interp);
+    if (_dotsf_run_prefix(interp, prog) == 1 && prefix.pc > 0)
+    {
+        size_t total = 0;
+        for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++){total += interp->stacks[si].count;}
+        size_t size = sizeof(dotsf_snapshot)+sizeof(dotsf_int)*total;
+        dotsf_snapshot* snap = calloc(1, size);
+        dotsf_int* data = (snap != NULL) ? (snap->data) : (NULL);
+        for (unsigned int si = 0; si < DOTSF_MAX_STACKS && snap != NULL; si++)
+        {
+            dotsf_stack* stack = interp->stacks+si;
+            snap->inuse[si] = stack->in_use;
+            snap->maxstack[si] = stack->maxstack;
+            snap->count[si] = stack->count;
+            for (dotsf_int sii = 0; sii < stack->count; sii++){*data++ = *_dotsf_slot(stack, sii);}
+        }
+        if (snap != NULL)
+        {
+            snap->start = prefix.pc;
+            snap->curstack = interp->curstack;
+            prog->snap = snap;
+            prog->snapsize = size;
+        }
+    }
+    dotsf_destroy(interp);
+}
+int _dotsf_load(dotsf_program** out, const char* src, unsigned int flags, size_t* erroff, dotsf_load_stats* stats, uint64_t steps) //dotsf_load, timed when stats isn't NULL.
+{
+    dotsf_program* prog = malloc(sizeof(dotsf_program));
+    *out = NULL;
+    if (prog == NULL){return -400;}
+    uint64_t started = (stats != NULL) ? (_dotsf_now_ns()) : (0);
+    int status = dotsf_compile(prog, src);
+    if (status < 0)
+    {
+        if (erroff != NULL){*erroff = prog->erroff;}
+        free(prog);
+        return status;
+    }
+    if (stats != NULL){stats->compile = _dotsf_now_ns()-started; stats->bytes = strlen(src); started = _dotsf_now_ns();}
+    //the JIT translates the program as written apart from the loops _dotsf_loop_idioms collapses, other superinstructions only help the interpreter.
+    #if DOTSF_HAVE_JIT
+    if ((flags & DOTSF_LOAD_JIT) && !(flags & DOTSF_LOAD_NO_OPT)){_dotsf_loop_idioms(prog);}
+    #endif
+    if (!((flags & DOTSF_LOAD_JIT) && dotsf_jit_compile(prog)) && !(flags & DOTSF_LOAD_NO_OPT)){dotsf_optimize(prog);}
+    if (stats != NULL){stats->optimize = _dotsf_now_ns()-started; started = _dotsf_now_ns();}
+    if ((flags & DOTSF_LOAD_PREEVAL) && prog->jitentry == NULL){_dotsf_preeval(prog, steps);} //native code always starts at the top.
+    if (stats != NULL){stats->preeval = _dotsf_now_ns()-started; stats->loaded = true;}
+    *out = prog;
+    return 0;
+}
+int dotsf_load(dotsf_program** out, const char* src, unsigned int flags, size_t* erroff)
+{
+    return _dotsf_load(out, src, flags, erroff, NULL, DOTSF_PREEVAL_STEPS);
+}
+void dotsf_unload(dotsf_program* prog)
+{
+    if (prog == NULL){return;}
+    dotsf_free_program(prog);
+    free(prog);
+}
+int dotsf_exec(dotsf_interpreter* interp, const char* src)
+{
+    dotsf_program* prog;
+    int status = dotsf_load(&prog, src, 0, NULL);
+    if (status == 0){status = dotsf_run(interp, prog);}
+    dotsf_unload(prog);
+    return status;
+}
+#if DOTSF_HAVE_PROFILE
+bool dotsf_profile_init(dotsf_profile* prof, const dotsf_program* prog) //counters sized for prog, interp->profile = prof turns profiling on.
+{
+    *prof = (dotsf_profile){ };
+    prof->counts = calloc(prog->len, sizeof(uint64_t));
+    prof->jumps = calloc(prog->len, sizeof(uint64_t));
+    if (prof->counts == NULL || prof->jumps == NULL){free(prof->counts); free(prof->jumps); return false;}
+    return true;
+}
+void dotsf_profile_free(dotsf_profile* prof)
+{
+    free(prof->counts);
+    free(prof->jumps);
+    *prof = (dotsf_profile){ };
+}
+typedef struct {
+    uint64_t count;
+    size_t pc;
+} dotsf_profile_entry;
+int _dotsf_profile_entry_cmp(const void* a, const void* b) //most executed first, then in program order.
+{
+    const dotsf_profile_entry *ea = a, *eb = b;
+    if (ea->count != eb->count){return (ea->count > eb->count) ? (-1) : (1);}
+    return (ea->pc > eb->pc) - (ea->pc < eb->pc);
+}
+/*
+    Prints what the profiling engine counted for prog, which has to be unoptimized so every instruction is one character of src.
+    Instructions and branches are sorted by how often they ran, and everything is annotated with its line and column.
+*/
+void dotsf_profile_report(const dotsf_profile* prof, const dotsf_program* prog, const char* src, double seconds, FILE* out)
+{
+    static const int hottest = 20;
+    dotsf_profile_entry* entries = malloc(sizeof(dotsf_profile_entry)*(prog->len+1));
+    if (entries == NULL){return;}
+    uint64_t total = 0;
+    size_t n = 0, line, col;
+    for (size_t pc = 0; pc < prog->len; pc++){total += prof->counts[pc];}
+    fprintf(out, "\n==== EXDotSF profile ====\n");
+    fprintf(out, "%" PRIu64 " instructions in %.3fs", total, seconds);
+    if (seconds > 0){fprintf(out, " (%.1f million/s)", total/seconds/1e6);}
+    fprintf(out, "\n%.3fs blocked in %" PRIu64 " reads and writes", prof->iotime/1e9, prof->iocalls);
+    if (seconds > 0){fprintf(out, " (%.1f%%)", 100.0*prof->iotime/1e9/seconds);}
+    fprintf(out, "\n\nstack high-water marks:\n");
+    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++)
+    {
+        if (prof->highwater[si] > 0){fprintf(out, "  stack %u: %i\n", si, prof->highwater[si]);}
+    }
+
+    for (size_t pc = 0; pc < prog->len; pc++){if (prof->counts[pc]){entries[n++] = (dotsf_profile_entry){.count=prof->counts[pc], .pc=pc};}}
+    qsort(entries, n, sizeof(dotsf_profile_entry), _dotsf_profile_entry_cmp);
+    fprintf(out, "\nhottest instructions:\n  %14s %7s  %-10s\n", "count", "%", "line:col");
+    for (size_t i = 0; i < n && i < (size_t)hottest; i++)
+    {
+        size_t pc = entries[i].pc;
+        char at[48];
+        _dotsf_line_col(src, prog->srcmap[pc], &line, &col);
+        snprintf(at, sizeof(at), "%zu:%zu", line, col);
+        //END is the only instruction without a character of its own.
+        char c = (prog->code[pc].op == DOTSF_OP_END) ? (0) : (src[prog->srcmap[pc]]);
+        fprintf(out, "  %14" PRIu64 " %6.2f%%  %-10s %c%s\n", entries[i].count, 100.0*entries[i].count/total, at, (c) ? (c) : (' '), (c) ? ("") : ("(end)"));
+    }
+
+    fprintf(out, "\nlabel jumps:\n");
+    for (int li = 0; li < 26; li++)
+    {
+        uint64_t jumps = 0;
+        size_t sites = 0, to = 0;
+        for (size_t pc = 0; pc < prog->len; pc++)
+        {
+            if (prog->code[pc].op != DOTSF_OP_JMP || src[prog->srcmap[pc]] != 'a'+li){continue;}
+            jumps += prof->jumps[pc];
+            sites++;
+            to = prog->code[pc].arg;
+        }
+        if (sites == 0){continue;}
+        _dotsf_line_col(src, prog->srcmap[to], &line, &col);
+        fprintf(out, "  %c  %14" PRIu64 " jumps from %zu site%s to %zu:%zu\n", 'a'+li, jumps, sites, (sites == 1) ? ("") : ("s"), line, col);
+    }
+
+    n = 0;
+    for (size_t pc = 0; pc < prog->len; pc++)
+    {
+        if ((prog->code[pc].op == DOTSF_OP_IFZ || prog->code[pc].op == DOTSF_OP_IF) && prof->counts[pc]){entries[n++] = (dotsf_profile_entry){.count=prof->counts[pc], .pc=pc};}
+    }
+    qsort(entries, n, sizeof(dotsf_profile_entry), _dotsf_profile_entry_cmp);
+    //a [ or ? that jumps skipped its block (or took the | part), one that doesn't entered it.
+    fprintf(out, "\nbranches:\n  %-10s %14s %14s %14s %9s\n", "line:col", "runs", "entered", "skipped", "entered%");
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t pc = entries[i].pc;
+        char at[48];
+        uint64_t skipped = prof->jumps[pc];
+        _dotsf_line_col(src, prog->srcmap[pc], &line, &col);
+        snprintf(at, sizeof(at), "%zu:%zu %c", line, col, src[prog->srcmap[pc]]);
+        fprintf(out, "  %-10s %14" PRIu64 " %14" PRIu64 " %14" PRIu64 " %8.2f%%\n", at, entries[i].count, entries[i].count-skipped, skipped, 100.0*(entries[i].count-skipped)/entries[i].count);
+    }
+    free(entries);
+}
+#endif
+#if DOTSF_HAVE_TRACE
+/*
+    --trace runs the program under the tracing engine, which writes every step into a ring buffer of the last N
+    (pc, source offset, opcode, top of the current stack, current stack) tuples, 16 bytes each and no I/O.
+    The ring is written out when the program fails, or whenever the process gets SIGUSR1, as a dotsf_trace_header,
+    the opcode names (DOTSF_TRACE_NAME_SIZE bytes each, so the file can be read without knowing this build),
+    then the entries oldest first, all in native byte order. tools/dotsftrace.c prints it.
+*/
+#define DOTSF_TRACE_MAGIC "EXDotSFt"
+#define DOTSF_TRACE_VERSION 1
+#define DOTSF_TRACE_NAME_SIZE 8
+typedef struct {
+    char magic[8];
+    uint32_t version, entrysize, opcount, count; //count entries follow the opcount names.
+    uint64_t steps; //how many were recorded in all, the first entry in the file is step steps-count.
+    int32_t status; //the Error Status the program failed with, 0 when it was still running.
+    uint32_t pad;
+} dotsf_trace_header;
+bool dotsf_trace_init(dotsf_trace* trace, size_t entries) //keeps at least the last entries steps, interp->trace = trace turns tracing on.
+{
+    size_t size = 2;
+    while (size < entries+1 && size < ((size_t)1 << 30)){size *= 2;}
+    *trace = (dotsf_trace){.mask=size-1};
+    return (trace->ring = calloc(size, sizeof(dotsf_trace_entry))) != NULL;
+}
+void dotsf_trace_free(dotsf_trace* trace)
+{
+    free(trace->ring);
+    *trace = (dotsf_trace){ };
+}
+bool _dotsf_write_all(int fd, const void* data, size_t size) //async-signal-safe.
+{
+    for (const char* p = data; size > 0; )
+    {
+        ptrdiff_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR){continue;}
+        if (n <= 0){return false;}
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+bool dotsf_trace_write(const dotsf_trace* trace, int status, int fd) //only calls write(2), so it can run in a signal handler.
+{
+    uint64_t steps = trace->steps, size = trace->mask+1, count = (steps < trace->mask) ? (steps) : (trace->mask), first = steps-count;
+    dotsf_trace_header header = {.magic=DOTSF_TRACE_MAGIC, .version=DOTSF_TRACE_VERSION, .entrysize=sizeof(dotsf_trace_entry),
+        .opcount=DOTSF_OP_COUNT, .count=count, .steps=steps, .status=status};
+    char names[DOTSF_OP_COUNT][DOTSF_TRACE_NAME_SIZE] = { };
+    for (unsigned int op = 0; op < DOTSF_OP_COUNT; op++)
+    {
+        for (unsigned int i = 0; i < DOTSF_TRACE_NAME_SIZE-1 && _dotsf_opnames[op][i]; i++){names[op][i] = _dotsf_opnames[op][i];}
+    }
+    //the oldest entry is at first & mask, the ring wraps around after the last slot.
+    uint64_t start = first & trace->mask, run = (start+count > size) ? (size-start) : (count);
+    return _dotsf_write_all(fd, &header, sizeof(header)) && _dotsf_write_all(fd, names, sizeof(names))
+        && _dotsf_write_all(fd, trace->ring+start, sizeof(dotsf_trace_entry)*run)
+        && _dotsf_write_all(fd, trace->ring, sizeof(dotsf_trace_entry)*(count-run));
+}
+bool dotsf_trace_save(const dotsf_trace* trace, int status, const char* path)
+{
+    int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0644);
+    if (fd < 0){return false;}
+    bool ok = dotsf_trace_write(trace, status, fd);
+    return (close(fd) == 0) && ok;
+}
+#endif
+/*
+    --emit-c turns a compiled program into C that #includes exdotsf.c (with DOTSF_NO_MAIN) for its stacks and I/O,
+    so every instruction keeps the exact semantics and error status it has in the engines.
+    Labels become goto targets. [ and ?|' blocks become if and if/else statements wherever they nest properly,
+    blocks that cross each other, or whose | is also a label, stay conditional gotos.
+*/
+bool dotsf_emit_c(const dotsf_program* prog, FILE* out)
+{
+    static const char* const opcode_c[DOTSF_OP_COUNT] = { //every instruction that isn't a jump, %i is its arg.
+        [DOTSF_OP_END] = "return 0;",
+        [DOTSF_OP_FAIL] = "return %i;",
+        [DOTSF_OP_PUSHD] = "if (!_dotsf_push(interp, %i)){return -13;}",
+        [DOTSF_OP_PUSHC] = "if (!_dotsf_push(interp, %i)){return -52;}",
+        [DOTSF_OP_PUSHN] = "if (!_dotsf_push(interp, %i)){return -54;}",
+        [DOTSF_OP_PRINTI] = "if (!_dotsf_pop(interp, &v1)){return -10;} _dotsf_out_int(interp, v1);",
+        [DOTSF_OP_PRINTC] = "if (!_dotsf_pop(interp, &v1)){return -10;} _dotsf_out_char(interp, v1);",
+        [DOTSF_OP_ADD] = "DOTSF_BINOP(v1+v2)",
+        [DOTSF_OP_SUB] = "DOTSF_BINOP(v1-v2)",
+        [DOTSF_OP_MUL] = "DOTSF_BINOP(v1*v2)",
+        [DOTSF_OP_DIV] = "DOTSF_DIVOP(v1/v2)",
+        [DOTSF_OP_MOD] = "DOTSF_BINOP(_dotsf_modulus(v1, v2))",
+        [DOTSF_OP_EQ] = "DOTSF_BINOP((dotsf_int)(v1 == v2))",
+        [DOTSF_OP_GT] = "DOTSF_BINOP((dotsf_int)(v1 > v2))",
+        [DOTSF_OP_LT] = "DOTSF_BINOP((dotsf_int)(v1 < v2))",
+        [DOTSF_OP_AND] = "DOTSF_BINOP((dotsf_int)(v1 && v2))",
+        [DOTSF_OP_LE] = "DOTSF_BINOP((dotsf_int)(v1 <= v2))",
+        [DOTSF_OP_GE] = "DOTSF_BINOP((dotsf_int)(v1 >= v2))",
+        [DOTSF_OP_READI] = "_dotsf_flush(interp); v1 = 0; if (!_dotsf_in_int(interp, &v1)){return -17;} if (!_dotsf_push(interp, v1)){return -18;}",
+        [DOTSF_OP_READC] = "_dotsf_flush(interp); v1 = _dotsf_in_char(interp); if (v1 == EOF){v1 = 0;} if (!_dotsf_push(interp, v1)){return -19;}",
+        [DOTSF_OP_DUP] = "if (!_dotsf_pop(interp, &v1)){return -20;} if (!_dotsf_push(interp, v1)){return -21;} if (!_dotsf_push(interp, v1)){return -22;}",
+        [DOTSF_OP_DUP2] = "if (!_dotsf_pop(interp, &v2)){return -23;} if (!_dotsf_pop(interp, &v1)){return -24;} "
+            "if (!_dotsf_push(interp, v1)){return -25;} if (!_dotsf_push(interp, v2)){return -26;} "
+            "if (!_dotsf_push(interp, v1)){return -27;} if (!_dotsf_push(interp, v2)){return -28;}",
+        [DOTSF_OP_READL] = "_dotsf_flush(interp); if ((status1 = _dotsf_in_line(interp)) != 0){return status1;}",
+        [DOTSF_OP_ROT] = "if (!_dotsf_popb_pusht(interp, interp->curstack)){return -33;}",
+        [DOTSF_OP_DUMP] = "_dotsf_dump_stack(interp);",
+        [DOTSF_OP_GCS] = "if (!_dotsf_push(interp, interp->curstack)){return -86;}",
+        [DOTSF_OP_NS] = "if (!_dotsf_pop(interp, &v2)){return -61;} if (!_dotsf_pop(interp, &v1)){return -62;} "
+            "if ((status1 = _dotsf_create_stack(interp, v1, v2, NULL)) != 0){return -(62+status1);}",
+        [DOTSF_OP_DS] = "if (!_dotsf_pop(interp, &v1)){return -70;} if ((status1 = _dotsf_delete_stack(interp, v1)) != 0){return -(70+status1);}",
+        [DOTSF_OP_TFA] = "if (!_dotsf_pop(interp, &v1)){return -80;} if (!_dotsf_pop_from_stack(interp, v1, &v2)){return -81;} if (!_dotsf_push(interp, v2)){return -82;}",
+        [DOTSF_OP_TFB] = "if (!_dotsf_pop(interp, &v1)){return -83;} if (!_dotsf_gettop(interp, v1, &v2)){return -84;} if (!_dotsf_push(interp, v2)){return -85;}",
+        [DOTSF_OP_TFC] = "if (!_dotsf_pop(interp, &v2)){return -90;} if (!_dotsf_pop(interp, &v1)){return -91;} if (!_dotsf_push_to_stack(interp, v2, v1)){return -92;}",
+        [DOTSF_OP_TFD] = "if (!_dotsf_pop(interp, &v2)){return -93;} if (!_dotsf_gettop(interp, interp->curstack, &v1)){return -94;} if (!_dotsf_push_to_stack(interp, v2, v1)){return -95;}",
+        [DOTSF_OP_TFE] = "if (!_dotsf_pop(interp, &v2)){return -96;} if (!_dotsf_popbottom(interp, v2, &v1)){return -97;} if (!_dotsf_push_to_stack(interp, interp->curstack, v1)){return -98;}",
+        [DOTSF_OP_TFF] = "if (!_dotsf_pop(interp, &v2)){return -99;} if (!_dotsf_getbottom(interp, v2, &v1)){return -100;} if (!_dotsf_push_to_stack(interp, interp->curstack, v1)){return -101;}",
+        [DOTSF_OP_TFG] = "if (!_dotsf_pop(interp, &v2)){return -90;} if (!_dotsf_popbottom(interp, interp->curstack, &v1)){return -91;} if (!_dotsf_push_to_stack(interp, v2, v1)){return -92;}",
+        [DOTSF_OP_TFH] = "if (!_dotsf_pop(interp, &v2)){return -90;} if (!_dotsf_getbottom(interp, interp->curstack, &v1)){return -91;} if (!_dotsf_push_to_stack(interp, v2, v1)){return -92;}",
+        [DOTSF_OP_CS] = "if (!_dotsf_pop(interp, &v1)){return -87;} if (v1 < 0 || v1 >= DOTSF_MAX_STACKS){return -89;} "
+            "if (!interp->stacks[v1].in_use){return -88;} interp->curstack = v1;",
+        [DOTSF_OP_CLR] = "if (!_dotsf_pop(interp, &v1)){return -107;} if (v1 < 0 || v1 >= DOTSF_MAX_STACKS){return -109;} "
+            "if (!interp->stacks[v1].in_use){return -108;} _dotsf_clear_stack(interp->stacks+v1);",
+        [DOTSF_OP_MVN] = "if (!_dotsf_pop(interp, &v2)){return -110;} if (!_dotsf_pop(interp, &v1)){return -111;} "
+            "if ((status1 = _dotsf_transfer(interp, v2, v1, true)) != 0){return -(111+status1);}",
+        [DOTSF_OP_CPN] = "if (!_dotsf_pop(interp, &v2)){return -115;} if (!_dotsf_pop(interp, &v1)){return -116;} "
+            "if ((status1 = _dotsf_transfer(interp, v2, v1, false)) != 0){return -(116+status1);}",
+        [DOTSF_OP_MVA] = "if (!_dotsf_pop(interp, &v2)){return -120;} "
+            "if ((status1 = _dotsf_transfer(interp, v2, interp->stacks[interp->curstack].count, true)) != 0){return -(120+status1);}",
+        [DOTSF_OP_CPA] = "if (!_dotsf_pop(interp, &v2)){return -124;} "
+            "if ((status1 = _dotsf_transfer(interp, v2, interp->stacks[interp->curstack].count, false)) != 0){return -(124+status1);}",
+        [DOTSF_OP_REV] = "if (!_dotsf_pop(interp, &v1)){return -128;} if (!_dotsf_reverse_top(interp->stacks+interp->curstack, v1)){return -129;}",
+        [DOTSF_OP_FILL] = "if (!_dotsf_pop(interp, &v2)){return -130;} if (!_dotsf_pop(interp, &v1)){return -131;} "
+            "if (!_dotsf_fill_top(interp->stacks+interp->curstack, v2, v1)){return -132;}",
+    };
+    for (size_t pc = 0; pc < prog->len; pc++){if (prog->code[pc].op >= DOTSF_OP_ADDK){return false;}} //superinstructions, emit C before dotsf_optimize.
+    if (prog->snap != NULL){return false;} //the generated code starts from an empty stack 0.
+    bool* target = calloc(prog->len+1, sizeof(bool)); //instructions that need a label.
+    size_t* ends = malloc(sizeof(size_t)*(prog->len+1)); //where each open block closes.
+    size_t* elseends = malloc(sizeof(size_t)*(prog->len+1)); //where the else part of an open if/else closes, 0 for plain ifs and else parts.
+    size_t depth = 0;
+    if (target == NULL || ends == NULL || elseends == NULL){free(target); free(ends); free(elseends); return false;}
+    for (size_t pc = 0; pc < prog->len; pc++){if (prog->code[pc].op == DOTSF_OP_JMP){target[prog->code[pc].arg] = true;}}
+    fputs("//generated by exdotsf --emit-c, build with: cc -O2 -I<directory containing exdotsf.c> <this file>\n"
+        "#define DOTSF_NO_MAIN\n"
+        "#include \"exdotsf.c\"\n"
+        "#define DOTSF_BINOP(expr) if (!_dotsf_pop(interp, &v2)){return -14;} if (!_dotsf_pop(interp, &v1)){return -15;} if (!_dotsf_push(interp, (expr))){return -16;}\n"
+        "#define DOTSF_DIVOP(expr) if (!_dotsf_pop(interp, &v2)){return -14;} if (!_dotsf_pop(interp, &v1)){return -15;} "
+            "if (_dotsf_div_traps(v1, v2)){return -133;} if (!_dotsf_push(interp, (expr))){return -16;}\n"
+        "int dotsf_compiled_program(dotsf_interpreter* interp)\n"
+        "{\n"
+        "    dotsf_int v1 = 0, v2 = 0;\n"
+        "    int status1 = 0;\n"
+        "    (void)v1; (void)v2; (void)status1;\n", out);
+    for (size_t pc = 0; pc < prog->len; pc++)
+    {
+        const dotsf_insn* insn = prog->code+pc;
+        bool skip = false;
+        while (depth > 0 && ends[depth-1] == pc)
+        {
+            if (elseends[depth-1] == 0){depth--; fprintf(out, "%*s}\n", (int)(4+depth*4), ""); continue;}
+            fprintf(out, "%*s}\n%*selse\n%*s{\n", (int)(depth*4), "", (int)(depth*4), "", (int)(depth*4), "");
+            ends[depth-1] = elseends[depth-1];
+            elseends[depth-1] = 0;
+            skip = true; //the | that ends the then part.
+        }
+        if (skip){continue;}
+        if (target[pc]){fprintf(out, "    L%zu:;\n", pc);}
+        int indent = 4+depth*4;
+        size_t outer = (depth > 0) ? (ends[depth-1]) : (prog->len);
+        switch (insn->op)
+        {
+            case DOTSF_OP_JMP: case DOTSF_OP_ELSE: fprintf(out, "%*sgoto L%zu;\n", indent, "", (size_t)insn->arg); target[insn->arg] = true; break;
+            case DOTSF_OP_IFZ: case DOTSF_OP_IF:
             {
-                case 'c': if (!_dotsf_push(interp, *++ip)){return -52;} break;
-                case 'n':
-                    hashopend = strchr(ip, '\\');
-                    if (hashopend-(ip+1) >= DOTSF_MAX_HASHOP_VAL_SIZE){return -51;}
-                    memset(hashopval, 0, DOTSF_MAX_HASHOP_VAL_SIZE);
-                    memcpy(hashopval, ip+1, hashopend-(ip+1));
-                    if (!sscanf(hashopval, "%i", &v1)){return -53;}
-                    if (!_dotsf_push(interp, v1)){return -54;}
-                    ip = hashopend;
-                    break;
-                case 'g':
-                    hashopend = strchr(ip, '\\');
-                    if (hashopend-(ip+1) >= DOTSF_MAX_HASHOP_VAL_SIZE){return -51;}
-                    memset(hashopval, 0, DOTSF_MAX_HASHOP_VAL_SIZE);
-                    memcpy(hashopval, ip+1, hashopend-(ip+1));
-                    if (strcmp(hashopval, "cs") == 0)
-                    {
-                        if (!_dotsf_push(interp, interp->curstack)){return -86;}
-                    }
-                    ip = hashopend;
-                    break;
-                case 's':
-                    hashopend = strchr(ip, '\\');
-                    if (hashopend-(ip+1) >= DOTSF_MAX_HASHOP_VAL_SIZE){return -51;}
-                    memset(hashopval, 0, DOTSF_MAX_HASHOP_VAL_SIZE);
-                    memcpy(hashopval, ip+1, hashopend-(ip+1));
-                    if (strcmp(hashopval, "ns") == 0) //create new stack.
-                    {
-                        if (!_dotsf_pop(interp, &v2)){return -61;}
-                        else if (!_dotsf_pop(interp, &v1)){return -62;}
-                        else {if ((status1 = _dotsf_create_stack(interp, v1, v2, NULL)) != 0){return -(62+status1);}}
-                    }
-                    else if (strcmp(hashopval, "ds") == 0) //delete stack.
-                    {
-                        if (!_dotsf_pop(interp, &v1)){return -70;}
-                        else if ((status1 = _dotsf_delete_stack(interp, v1)) != 0){return -(70+status1);}
-                    }
-                    else if (strcmp(hashopval, "tfa") == 0) //pop the top element off another stack and push it to the current stack's top.
-                    {
-                        if (!_dotsf_pop(interp, &v1)){return -80;}
-                        else if (!_dotsf_pop_from_stack(interp, v1, &v2)){return -81;}
-                        else if (!_dotsf_push(interp, v2)){return -82;}
-                    }
-                    else if (strcmp(hashopval, "tfb") == 0) //peeks another stack's top value and pushes it to top of the current stack.
-                    {
-                        if (!_dotsf_pop(interp, &v1)){return -83;}
-                        else if (!_dotsf_gettop(interp, v1, &v2)){return -84;}
-                        else if (!_dotsf_push(interp, v2)){return -85;}
-                    }
-                    else if (strcmp(hashopval, "tfc") == 0) //pops the last value before the given stack index off the top of the current stack and pushes it to the top of the other stack with the given index.
-                    {
-                        if (!_dotsf_pop(interp, &v2)){return -90;}
-                        else if (!_dotsf_pop(interp, &v1)){return -91;}
-                        else if (!_dotsf_push_to_stack(interp, v2, v1)){return -92;}
-                    }
-                    else if (strcmp(hashopval, "tfd") == 0) //similar to tfc but peeks the value from the top of the current instead.
-                    {
-                        if (!_dotsf_pop(interp, &v2)){return -93;}
-                        else if (!_dotsf_gettop(interp, interp->curstack, &v1)){return -94;}
-                        else if (!_dotsf_push_to_stack(interp, v2, v1)){return -95;}
-                    }
-                    else if (strcmp(hashopval, "tfe") == 0) // tfa but pops off the other stack's bottom instead of the top
-                    {
-                        if (!_dotsf_pop(interp, &v2)){return -96;}
-                        else if (!_dotsf_popbottom(interp, v2, &v1)){return -97;}
-                        else if (!_dotsf_push_to_stack(interp, interp->curstack, v1)){return -98;}
-                    }
-                    else if (strcmp(hashopval, "tff") == 0) // tfb but peeks into the other stack's bottom instead of the top
-                    {
-                        if (!_dotsf_pop(interp, &v2)){return -99;}
-                        else if (!_dotsf_getbottom(interp, v2, &v1)){return -100;}
-                        else if (!_dotsf_push_to_stack(interp, interp->curstack, v1)){return -101;}
-                    }
-                    else if (strcmp(hashopval, "tfg") == 0) // vice versa of tfe
-                    {
-                        if (!_dotsf_pop(interp, &v2)){return -90;}
-                        else if (!_dotsf_popbottom(interp, interp->curstack, &v1)){return -91;}
-                        else if (!_dotsf_push_to_stack(interp, v2, v1)){return -92;}
-                    }
-                    else if (strcmp(hashopval, "tfh") == 0) // vice versa of tff.
-                    {
-                        if (!_dotsf_pop(interp, &v2)){return -90;}
-                        else if (!_dotsf_getbottom(interp, interp->curstack, &v1)){return -91;}
-                        else if (!_dotsf_push_to_stack(interp, v2, v1)){return -92;}
-                    }
-                    else if (strcmp(hashopval, "cs") == 0) //pops a value off the top of the current stack and use it to set the current stack index.
-                    {
-                        if (!_dotsf_pop(interp, &v1)){return -87;}
-                        if (v1 < 0 || v1 >= DOTSF_MAX_STACKS){return -89;}
-                        stack = interp->stacks+v1;
-                        if (!stack->in_use){return -88;}
-                        interp->curstack = v1;
-                    }
-                    else if (strcmp(hashopval, "clr") == 0) //pops a value off the current stack (the requested stack index) and clears everything off that stack.
-                    {
-                        dotsf_int _dummy;
-                        if (!_dotsf_pop(interp, &v1)){return -107;}
-                        if (v1 < 0 || v1 >= DOTSF_MAX_STACKS){return -109;}
-                        stack = interp->stacks+v1;
-                        if (!stack->in_use){return -108;}
-                        while (_dotsf_pop_from_stack(interp, v1, &_dummy)){;}
-                    }
-                    ip = hashopend;
-                    break;
-                default: return -60;
+                size_t end = insn->arg, elseend = 0;
+                if (insn->op == DOTSF_OP_IF){elseend = prog->code[end-1].arg; end--;} //the then part ends at the |.
+                fprintf(out, "%*sif (!_dotsf_pop(interp, &v1)){return %i;}\n", indent, "", (insn->op == DOTSF_OP_IF) ? (-30) : (-10));
+                if (((elseend) ? (elseend) : (end)) <= outer && !(elseend && target[end]))
+                {
+                    fprintf(out, "%*sif (v1)\n%*s{\n", indent, "", indent, "");
+                    ends[depth] = end;
+                    elseends[depth++] = elseend;
+                }
+                else
+                {
+                    fprintf(out, "%*sif (!v1){goto L%zu;}\n", indent, "", (size_t)insn->arg);
+                    target[insn->arg] = true;
+                }
+                break;
             }
+            default: fprintf(out, "%*s", indent, ""); fprintf(out, opcode_c[insn->op], insn->arg); fputc('\n', out); break;
         }
-        else if (*ip == '`')
+    }
+    fputs("}\n"
+        "int main(void)\n"
+        "{\n"
+        "    dotsf_interpreter* interp = dotsf_create(NULL);\n"
+        "    if (interp == NULL){printf(\"\\nError Status -400\\n\"); return -400;}\n"
+        "    dotsf_set_line_buffered(interp, isatty(STDOUT_FILENO));\n"
+        "    _dotsf_reset_stacks(interp);\n"
+        "    int res = dotsf_compiled_program(interp);\n"
+        "    _dotsf_flush(interp);\n"
+        "    dotsf_destroy(interp);\n"
+        "    if (res < 0){printf(\"\\nError Status %i\\n\", res);}\n"
+        "    return res;\n"
+        "}\n", out);
+    free(target);
+    free(ends);
+    free(elseends);
+    return !ferror(out);
+}
+
+typedef struct {
+    char* text; //always NUL terminated.
+    size_t size, mapsize; //mapsize is 0 unless text is mapped.
+} dotsf_source;
+bool _dotsf_read_all(int fd, dotsf_source* source) //the fallback for pipes, terminals and systems without mmap.
+{
+    size_t cap = 65536;
+    source->text = malloc(cap);
+    source->size = 0;
+    while (source->text != NULL)
+    {
+        if (cap-source->size < 2)
         {
-            stack = interp->stacks+interp->curstack;
-            puts("\nTHE CURRENT STACK IS:\n");
-            for (dotsf_int sii = 0; sii <= stack->stacktop; sii++)
+            char* bigger = realloc(source->text, cap*2);
+            if (bigger == NULL){break;}
+            source->text = bigger;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, source->text+source->size, cap-source->size-1);
+        if (n < 0 && errno == EINTR){continue;}
+        if (n < 0){break;}
+        if (n == 0){source->text[source->size] = 0; return true;}
+        source->size += n;
+    }
+    free(source->text);
+    source->text = NULL;
+    return false;
+}
+int dotsf_load_source(dotsf_source* source, const char* path) //"-" is stdin. returns 0, -666 if path can't be opened or -667 if it can't be read.
+{
+    *source = (dotsf_source){ };
+    int fd = (strcmp(path, "-") == 0) ? (STDIN_FILENO) : (open(path, O_RDONLY|O_BINARY));
+    if (fd < 0){return -666;}
+    #if DOTSF_HAVE_MMAP
+    struct stat st;
+    if (fd != STDIN_FILENO && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        /*
+            The file is mapped over an anonymous, zero filled reservation that is at least one byte longer than the file,
+            so the byte after the last one is always a readable NUL even when the file ends on a page boundary.
+        */
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t mapsize = ((size_t)st.st_size+1+page-1)/page*page;
+        char* base = mmap(NULL, mapsize, PROT_READ, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED)
+        {
+            if (mmap(base, st.st_size, PROT_READ, MAP_PRIVATE|MAP_FIXED, fd, 0) != MAP_FAILED)
             {
-                printf("%i = %i\n", sii, stack->stack[sii]);
+                madvise(base, st.st_size, MADV_SEQUENTIAL);
+                close(fd);
+                *source = (dotsf_source){.text=base, .size=st.st_size, .mapsize=mapsize};
+                return 0;
             }
-            puts("");
+            munmap(base, mapsize);
+        }
+    }
+    #endif
+    bool ok = _dotsf_read_all(fd, source);
+    if (fd != STDIN_FILENO){close(fd);}
+    return (ok) ? (0) : (-667);
+}
+void dotsf_free_source(dotsf_source* source)
+{
+    #if DOTSF_HAVE_MMAP
+    if (source->mapsize){munmap(source->text, source->mapsize);}
+    else
+    #endif
+    {free(source->text);}
+    *source = (dotsf_source){ };
+}
+uint64_t _dotsf_hash(const char* text, size_t size) //FNV-1a.
+{
+    uint64_t h = 14695981039346656037u;
+    for (size_t i = 0; i < size; i++){h = (h^(unsigned char)text[i])*1099511628211u;}
+    return h;
+}
+#if DOTSF_HAVE_MMAP
+/*
+    --cache keeps the loaded program in a file: a dotsf_cache_header followed by the instructions, the srcmap
+    and the --preeval snapshot if there is one, exactly as dotsf_load left them, so jumps are already resolved,
+    # operations decoded and constants folded.
+    (Labels only exist as the jump targets they resolved to, there is no table of them left to store.)
+    A later run maps the file and runs the instructions in place. If the source's size and mtime still match,
+    it isn't even opened, otherwise it is read and hashed and a matching hash still counts as a hit.
+    Anything else (a stale hash, a different build, other load flags or --preeval budget, a file whose contents no longer
+    match its datahash or make no sense, see _dotsf_cache_valid) means the source is compiled again and the file rewritten.
+*/
+#define DOTSF_CACHE_MAGIC "EXDotSFc"
+#define DOTSF_CACHE_VERSION 4 //bump whenever the meaning of the instructions changes without DOTSF_OP_COUNT or sizeof(dotsf_insn) changing.
+typedef struct {
+    char magic[8];
+    uint32_t version, opcount, insnsize, flags; //flags are dotsf_load's, DOTSF_LOAD_JIT matters since it leaves the program unfused but for its loops.
+    uint64_t srchash, srcsize, srcmtime; //srcmtime is in nanoseconds.
+    uint64_t len, snapsize; //snapsize is 0 without a snapshot, which comes after the srcmap.
+    uint64_t preeval; //the --preeval step budget the snapshot was taken with, 0 without DOTSF_LOAD_PREEVAL.
+    uint64_t datahash; //of everything after the header, see _dotsf_cache_hash.
+} dotsf_cache_header;
+#define DOTSF_CACHE_HASH_SEED 14695981039346656037u
+uint64_t _dotsf_cache_hash(uint64_t h, const void* data, size_t size) //FNV-1a over 4 byte words continuing from h, size is a multiple of 4.
+{
+    //every hit hashes the whole file, so this goes a word at a time rather than a byte. A word that differs still always changes the result.
+    const unsigned char* p = data;
+    uint32_t w;
+    for (size_t i = 0; i+4 <= size; i += 4){memcpy(&w, p+i, 4); h = (h^w)*1099511628211u;}
+    return h;
+}
+uint64_t _dotsf_mtime_ns(const struct stat* st)
+{
+    #if defined(__APPLE__)
+    return (uint64_t)st->st_mtimespec.tv_sec*1000000000u+st->st_mtimespec.tv_nsec;
+    #else
+    return (uint64_t)st->st_mtim.tv_sec*1000000000u+st->st_mtim.tv_nsec;
+    #endif
+}
+bool _dotsf_cache_save(const dotsf_program* prog, const char* cachepath, const dotsf_cache_header* key)
+{
+    //written next to the old file and renamed over it, so a run that maps the old one keeps a consistent copy.
+    dotsf_cache_header header = *key;
+    char* tmppath = malloc(strlen(cachepath)+32);
+    bool ok = tmppath != NULL;
+    header.len = prog->len;
+    header.snapsize = (prog->snap != NULL) ? (prog->snapsize) : (0);
+    header.datahash = _dotsf_cache_hash(_dotsf_cache_hash(DOTSF_CACHE_HASH_SEED, prog->code, sizeof(dotsf_insn)*prog->len), prog->srcmap, sizeof(uint32_t)*prog->len);
+    if (header.snapsize > 0){header.datahash = _dotsf_cache_hash(header.datahash, prog->snap, header.snapsize);}
+    if (ok){sprintf(tmppath, "%s.%ld.tmp", cachepath, (long)getpid());}
+    FILE* out = (ok) ? (fopen(tmppath, "wb")) : (NULL);
+    if (out == NULL){free(tmppath); return false;}
+    ok = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(prog->code, sizeof(dotsf_insn), prog->len, out) == prog->len
+        && fwrite(prog->srcmap, sizeof(uint32_t), prog->len, out) == prog->len
+        && (header.snapsize == 0 || fwrite(prog->snap, header.snapsize, 1, out) == 1);
+    ok = (fclose(out) == 0) && ok && rename(tmppath, cachepath) == 0;
+    if (!ok){remove(tmppath);}
+    free(tmppath);
+    return ok;
+}
+bool _dotsf_cache_valid(const dotsf_program* prog) //false for anything dotsf_load couldn't have left, so a damaged file is a miss rather than a crash.
+{
+    //the srcmap is only ever read together with the source, which --dump and --profile load themselves without the cache.
+    const dotsf_snapshot* snap = prog->snap;
+    uint8_t last = (prog->len > 0) ? (prog->code[prog->len-1].op) : (DOTSF_OP_COUNT);
+    if (last != DOTSF_OP_END && last != DOTSF_OP_FAIL && last != DOTSF_OP_JMP){return false;} //nothing may run off the end.
+    for (size_t pc = 0; pc < prog->len; pc++)
+    {
+        const dotsf_insn* insn = prog->code+pc;
+        int pops, room, delta, depth = 0, need = 0, grow = 0;
+        if (insn->op >= DOTSF_OP_COUNT){return false;}
+        if (_dotsf_is_jump(insn->op) && (insn->arg < 0 || (size_t)insn->arg >= prog->len)){return false;}
+        if (insn->op != DOTSF_OP_GUARD && insn->op != DOTSF_OP_LOOP){continue;}
+        if (insn->len < 1 || insn->len >= prog->len-pc){return false;}
+        for (size_t ui = 1; ui <= insn->len; ui++)
+        {
+            if (insn->op == DOTSF_OP_LOOP){if (insn[ui].op != DOTSF_OP_LSLOT){return false;} continue;}
+            //a GUARD lets the instructions it covers run unchecked, so its limits have to be exactly what _dotsf_guard_blocks works out.
+            if (!_dotsf_stack_effect(insn[ui].op, &pops, &room, &delta)){return false;}
+            if (pops-depth > need){need = pops-depth;}
+            if (depth+room > grow){grow = depth+room;}
+            depth += delta;
+        }
+        if (insn->op == DOTSF_OP_LOOP && insn[insn->len].arg == 0){return false;} //the step _dotsf_loop divides by.
+        if (insn->op == DOTSF_OP_GUARD && (insn->arg != need || insn->arg2 != grow)){return false;}
+    }
+    if (snap == NULL){return true;}
+    uint64_t total = 0;
+    if (snap->start >= prog->len || snap->curstack >= DOTSF_MAX_STACKS){return false;}
+    for (unsigned int si = 0; si < DOTSF_MAX_STACKS; si++)
+    {
+        if (snap->inuse[si] != 0 && snap->inuse[si] != 1){return false;}
+        if (snap->maxstack[si] < 0 || snap->count[si] < 0 || snap->count[si] > snap->maxstack[si] || (!snap->inuse[si] && snap->count[si] != 0)){return false;}
+        total += snap->count[si];
+    }
+    return prog->snapsize == sizeof(dotsf_snapshot)+total*sizeof(dotsf_int);
+}
+dotsf_program* _dotsf_cache_map(const char* cachepath, const dotsf_cache_header* key, bool bystat) //NULL unless cachepath holds the program key describes.
+{
+    int fd = open(cachepath, O_RDONLY|O_BINARY);
+    struct stat st;
+    if (fd < 0){return NULL;}
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(dotsf_cache_header)){close(fd); return NULL;}
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED){return NULL;}
+    const dotsf_cache_header* header = map;
+    bool same = memcmp(header->magic, key->magic, 8) == 0 && header->version == key->version && header->opcount == key->opcount
+        && header->insnsize == key->insnsize && header->flags == key->flags && header->preeval == key->preeval
+        && header->len <= (st.st_size-sizeof(dotsf_cache_header))/(sizeof(dotsf_insn)+sizeof(uint32_t)) && header->snapsize <= (uint64_t)st.st_size
+        && st.st_size == (off_t)(sizeof(dotsf_cache_header)+header->len*(sizeof(dotsf_insn)+sizeof(uint32_t))+header->snapsize)
+        && (header->snapsize == 0 || header->snapsize >= sizeof(dotsf_snapshot))
+        && header->datahash == _dotsf_cache_hash(DOTSF_CACHE_HASH_SEED, header+1, st.st_size-sizeof(dotsf_cache_header)); //a damaged file is a miss.
+    if (same && bystat){same = header->srcsize == key->srcsize && header->srcmtime == key->srcmtime;}
+    else if (same){same = header->srchash == key->srchash && header->srcsize == key->srcsize;}
+    dotsf_program* prog = (same) ? (calloc(1, sizeof(dotsf_program))) : (NULL);
+    if (prog == NULL){munmap(map, st.st_size); return NULL;}
+    prog->code = (dotsf_insn*)(header+1);
+    prog->srcmap = (uint32_t*)(prog->code+header->len);
+    prog->len = prog->cap = header->len;
+    if (header->snapsize > 0){prog->snap = (dotsf_snapshot*)(prog->srcmap+header->len); prog->snapsize = header->snapsize;}
+    prog->map = map;
+    prog->mapsize = st.st_size;
+    if (!_dotsf_cache_valid(prog)){dotsf_unload(prog); return NULL;}
+    return prog;
+}
+int _dotsf_load_cached(dotsf_program** out, dotsf_source* source, const char* path, const char* cachepath, unsigned int flags, size_t* erroff, dotsf_load_stats* stats, uint64_t steps)
+{
+    //like dotsf_load_source followed by dotsf_load, except that source is left empty when the cache made reading it unnecessary.
+    dotsf_cache_header key = {.magic=DOTSF_CACHE_MAGIC, .version=DOTSF_CACHE_VERSION, .opcount=DOTSF_OP_COUNT, .insnsize=sizeof(dotsf_insn), .flags=flags};
+    struct stat st;
+    int status;
+    *source = (dotsf_source){ };
+    if (stat(path, &st) != 0){return -666;}
+    key.srcsize = st.st_size;
+    key.srcmtime = _dotsf_mtime_ns(&st);
+    key.preeval = (flags & DOTSF_LOAD_PREEVAL) ? (steps) : (0);
+    if ((*out = _dotsf_cache_map(cachepath, &key, true)) != NULL){if (flags & DOTSF_LOAD_JIT){dotsf_jit_compile(*out);}} //native code isn't cached, only what it is made from.
+    else
+    {
+        if ((status = dotsf_load_source(source, path)) != 0){return status;}
+        key.srcsize = source->size;
+        key.srchash = _dotsf_hash(source->text, source->size);
+        if ((*out = _dotsf_cache_map(cachepath, &key, false)) != NULL) //only the mtime changed.
+        {
+            _dotsf_cache_save(*out, cachepath, &key);
+            if (flags & DOTSF_LOAD_JIT){dotsf_jit_compile(*out);}
+        }
+        else
+        {
+            if ((status = _dotsf_load(out, source->text, flags, erroff, stats, steps)) != 0){return status;}
+            _dotsf_cache_save(*out, cachepath, &key); //a cache that can't be written just means compiling again next time.
         }
-        else {;}
     }
     return 0;
-    #undef _dotsf_modulus
 }
+#endif
+#if DOTSF_HAVE_BATCH
+/*
+    --batch runs one program over many inputs. The program is loaded once and every worker thread keeps one interpreter
+    for all its jobs, so each job starts with the stack buffers the one before it left behind in interp->spares.
+    Every worker starts out owning a range of the input list and takes jobs from its front. A worker whose range runs dry
+    steals the back half of the largest one left, so a few slow inputs don't leave the other cores idle.
+    A job's output goes to its own file in outdir, or is kept in memory until every job before it has been written to stdout,
+    either way it is exactly what `exdotsf program < input` would have printed, Error Status included.
+*/
+typedef struct {
+    char* data;
+    size_t len, cap;
+} dotsf_membuf;
+typedef struct {
+    pthread_mutex_t lock;
+    size_t lo, hi; //the jobs this worker hasn't started yet.
+} dotsf_batch_range;
+typedef struct {
+    const dotsf_program* prog;
+    const char* const* inputs;
+    const char* outdir; //NULL for the ordered stream on stdout.
+    size_t count;
+    unsigned int nworkers;
+    dotsf_batch_range* ranges;
+    dotsf_interpreter** interps;
+    int* statuses;
+    dotsf_membuf* outputs;
+    bool* finished;
+    size_t nextout; //the first job whose output hasn't gone to stdout yet.
+    pthread_mutex_t outlock;
+} dotsf_batch;
+typedef struct {
+    dotsf_batch* batch;
+    unsigned int id;
+} dotsf_batch_worker;
+typedef struct {
+    int infd, outfd; //outfd is -1 when the output is kept in mem.
+    dotsf_membuf* mem;
+} dotsf_batch_io;
+bool _dotsf_membuf_append(dotsf_membuf* mem, const void* bytes, size_t count)
+{
+    if (mem->cap-mem->len < count)
+    {
+        size_t newcap = (mem->cap) ? (mem->cap) : (4096);
+        while (newcap-mem->len < count){newcap *= 2;}
+        char* grown = realloc(mem->data, newcap);
+        if (grown == NULL){return false;}
+        mem->data = grown;
+        mem->cap = newcap;
+    }
+    memcpy(mem->data+mem->len, bytes, count);
+    mem->len += count;
+    return true;
+}
+ptrdiff_t _dotsf_batch_read(void* ctx, void* buf, size_t size)
+{
+    ssize_t n;
+    do {n = read(((dotsf_batch_io*)ctx)->infd, buf, size);} while (n < 0 && errno == EINTR);
+    return n;
+}
+ptrdiff_t _dotsf_batch_write(void* ctx, const void* buf, size_t size)
+{
+    dotsf_batch_io* bio = ctx;
+    if (bio->outfd < 0){return (_dotsf_membuf_append(bio->mem, buf, size)) ? ((ptrdiff_t)size) : (-1);}
+    ssize_t n;
+    do {n = write(bio->outfd, buf, size);} while (n < 0 && errno == EINTR);
+    return n;
+}
+const char* _dotsf_batch_name(const char* input) //what --out-dir names input's output after, with ".out" added.
+{
+    const char* name = strrchr(input, '/');
+    return (name != NULL) ? (name+1) : (input);
+}
+int _dotsf_batch_cmp_names(const void* a, const void* b)
+{
+    return strcmp(_dotsf_batch_name(*(const char* const*)a), _dotsf_batch_name(*(const char* const*)b));
+}
+bool _dotsf_batch_clash(const char* const* inputs, size_t count, const char** first, const char** second) //finds two inputs --out-dir would give the same output file.
+{
+    const char** sorted = malloc(sizeof(char*)*(count+1));
+    bool clash = false;
+    if (sorted == NULL){return false;} //caught again when the batch itself runs out of memory.
+    memcpy(sorted, inputs, sizeof(char*)*count);
+    qsort(sorted, count, sizeof(char*), _dotsf_batch_cmp_names);
+    for (size_t ii = 1; ii < count && !clash; ii++)
+    {
+        if (strcmp(_dotsf_batch_name(sorted[ii-1]), _dotsf_batch_name(sorted[ii])) == 0){*first = sorted[ii-1]; *second = sorted[ii]; clash = true;}
+    }
+    free(sorted);
+    return clash;
+}
+int _dotsf_batch_job(dotsf_batch* batch, dotsf_interpreter* interp, size_t job)
+{
+    const char* input = batch->inputs[job];
+    dotsf_batch_io bio = {.infd=open(input, O_RDONLY|O_BINARY), .outfd=-1, .mem=batch->outputs+job};
+    dotsf_io io = {.read=_dotsf_batch_read, .write=_dotsf_batch_write, .ctx=&bio};
+    char line[64];
+    int status = -666, len;
+    if (batch->outdir != NULL)
+    {
+        char* path = malloc(strlen(batch->outdir)+strlen(input)+8);
+        if (path == NULL){close(bio.infd); return -400;}
+        sprintf(path, "%s/%s.out", batch->outdir, _dotsf_batch_name(input));
+        bio.outfd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
+        free(path);
+        if (bio.outfd < 0){close(bio.infd); return -669;}
+    }
+    if (bio.infd >= 0)
+    {
+        dotsf_set_io(interp, &io);
+        status = dotsf_run(interp, batch->prog);
+        if (status < 0){len = snprintf(line, sizeof(line), "\nError Status %i\n", status); _dotsf_batch_write(&bio, line, len);}
+        close(bio.infd);
+    }
+    else
+    {
+        _dotsf_batch_write(&bio, "ERROR: No file named ", sizeof("ERROR: No file named ")-1);
+        _dotsf_batch_write(&bio, input, strlen(input));
+        _dotsf_batch_write(&bio, "\n", 1);
+    }
+    if (bio.outfd >= 0){close(bio.outfd);}
+    return status;
+}
+bool _dotsf_batch_next(dotsf_batch* batch, unsigned int id, size_t* job) //false once every job has been taken.
+{
+    dotsf_batch_range* own = batch->ranges+id;
+    pthread_mutex_lock(&own->lock);
+    bool found = own->lo < own->hi;
+    if (found){*job = own->lo++;}
+    pthread_mutex_unlock(&own->lock);
+    while (!found)
+    {
+        unsigned int victim = 0;
+        size_t most = 0;
+        for (unsigned int w = 0; w < batch->nworkers; w++)
+        {
+            dotsf_batch_range* range = batch->ranges+w;
+            pthread_mutex_lock(&range->lock);
+            if (range->hi-range->lo > most){most = range->hi-range->lo; victim = w;}
+            pthread_mutex_unlock(&range->lock);
+        }
+        if (most == 0){return false;}
+        dotsf_batch_range* range = batch->ranges+victim;
+        size_t lo = 0, hi = 0;
+        pthread_mutex_lock(&range->lock);
+        if (range->lo < range->hi)
+        {
+            lo = range->lo+(range->hi-range->lo)/2;
+            hi = range->hi;
+            range->hi = lo;
+        }
+        pthread_mutex_unlock(&range->lock);
+        if (lo == hi){continue;} //someone else got there first.
+        pthread_mutex_lock(&own->lock);
+        own->lo = lo+1;
+        own->hi = hi;
+        pthread_mutex_unlock(&own->lock);
+        *job = lo;
+        found = true;
+    }
+    return true;
+}
+void _dotsf_batch_output(dotsf_batch* batch, size_t job) //marks job done and writes out every finished job that is next in line.
+{
+    pthread_mutex_lock(&batch->outlock);
+    batch->finished[job] = true;
+    while (batch->nextout < batch->count && batch->finished[batch->nextout])
+    {
+        dotsf_membuf* mem = batch->outputs+batch->nextout++;
+        for (size_t done = 0; done < mem->len; )
+        {
+            ptrdiff_t n = _dotsf_std_write(NULL, mem->data+done, mem->len-done);
+            if (n <= 0){break;}
+            done += n;
+        }
+        free(mem->data);
+        *mem = (dotsf_membuf){ };
+    }
+    pthread_mutex_unlock(&batch->outlock);
+}
+void* _dotsf_batch_worker(void* arg)
+{
+    dotsf_batch_worker* worker = arg;
+    dotsf_batch* batch = worker->batch;
+    size_t job;
+    while (_dotsf_batch_next(batch, worker->id, &job))
+    {
+        batch->statuses[job] = _dotsf_batch_job(batch, batch->interps[worker->id], job);
+        if (batch->outdir == NULL){_dotsf_batch_output(batch, job);}
+    }
+    return NULL;
+}
+int _dotsf_run_batch(const dotsf_program* prog, dotsf_engine engine, const char* const* inputs, size_t count, const char* outdir, unsigned int nworkers)
+{
+    //returns the status of the first input (in list order) that failed, or 0.
+    dotsf_batch batch = {.prog=prog, .inputs=inputs, .outdir=outdir, .count=count};
+    int status = 0;
+    size_t failed = 0;
+    if (count == 0){return 0;}
+    if (nworkers > count){nworkers = count;}
+    if (nworkers < 1){nworkers = 1;}
+    batch.ranges = calloc(nworkers, sizeof(dotsf_batch_range));
+    batch.interps = calloc(nworkers, sizeof(dotsf_interpreter*));
+    batch.statuses = calloc(count, sizeof(int));
+    batch.outputs = calloc(count, sizeof(dotsf_membuf));
+    batch.finished = calloc(count, sizeof(bool));
+    dotsf_batch_worker* workers = calloc(nworkers, sizeof(dotsf_batch_worker));
+    pthread_t* threads = calloc(nworkers, sizeof(pthread_t));
+    bool ok = batch.ranges && batch.interps && batch.statuses && batch.outputs && batch.finished && workers && threads;
+    for (unsigned int w = 0; ok && w < nworkers; w++)
+    {
+        batch.ranges[w] = (dotsf_batch_range){.lo=count*w/nworkers, .hi=count*(w+1)/nworkers};
+        pthread_mutex_init(&batch.ranges[w].lock, NULL);
+        workers[w] = (dotsf_batch_worker){.batch=&batch, .id=w};
+        ok = (batch.interps[w] = dotsf_create(NULL)) != NULL;
+        if (ok){dotsf_set_engine(batch.interps[w], engine);}
+        batch.nworkers = w+1;
+    }
+    if (ok)
+    {
+        pthread_mutex_init(&batch.outlock, NULL);
+        //the calling thread is worker 0, a worker that couldn't be started just leaves its range to be stolen.
+        unsigned int started = 1;
+        for (; started < nworkers; started++)
+        {
+            if (pthread_create(threads+started, NULL, _dotsf_batch_worker, workers+started) != 0){break;}
+        }
+        _dotsf_batch_worker(workers);
+        for (unsigned int w = 1; w < started; w++){pthread_join(threads[w], NULL);}
+        pthread_mutex_destroy(&batch.outlock);
+        for (size_t job = 0; job < count; job++)
+        {
+            if (batch.statuses[job] < 0){failed++; if (status == 0){status = batch.statuses[job];}}
+        }
+        if (failed > 0){fprintf(stderr, "%zu of %zu inputs failed\n", failed, count);}
+    }
+    else {status = -400;}
+    for (unsigned int w = 0; batch.ranges != NULL && w < batch.nworkers; w++)
+    {
+        pthread_mutex_destroy(&batch.ranges[w].lock);
+        dotsf_destroy(batch.interps[w]);
+    }
+    free(batch.ranges);
+    free(batch.interps);
+    free(batch.statuses);
+    free(batch.outputs);
+    free(batch.finished);
+    free(workers);
+    free(threads);
+    return status;
+}
+bool _dotsf_batch_list(const char* path, const char*** inputs, size_t* count, size_t* cap) //appends every line of path ("-" is stdin) to inputs.
+{
+    FILE* list = (strcmp(path, "-") == 0) ? (stdin) : (fopen(path, "r"));
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    if (list == NULL){return false;}
+    while ((len = getline(&line, &size, list)) >= 0)
+    {
+        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')){line[--len] = 0;}
+        if (len == 0){continue;}
+        if (*count == *cap)
+        {
+            const char** grown = realloc(*inputs, sizeof(char*)*((*cap) *= 2));
+            if (grown == NULL){break;}
+            *inputs = grown;
+        }
+        if (((*inputs)[*count] = strdup(line)) == NULL){break;}
+        (*count)++;
+    }
+    bool ok = !ferror(list) && feof(list);
+    free(line);
+    if (list != stdin){fclose(list);}
+    return ok;
+}
+#endif
+#if DOTSF_HAVE_SERVE
+/*
+    --serve PATH listens on a Unix socket and runs programs sent to it, so a request only costs the run itself:
+    every worker thread keeps one interpreter (and with it its stack buffers) for all its requests, and loaded programs
+    are kept in an LRU cache keyed by their source, so a program sent again skips loading altogether.
+    A connection carries any number of requests, one after the other, in native byte order (both ends are on this machine):
+        request:  dotsf_serve_request, then srclen bytes of program, then inlen bytes of input for it.
+        response: any number of output frames (a uint32_t length > 0 and that many bytes), then a uint32_t 0 and the
+                  int32_t status exdotsf would have exited with. A program that fails to load gets its load error status.
+                  A program that fails while running, dividing by 0 with / included, only ends its own request this way and
+                  never the server.
+    tools/dotsfclient.c is a client that behaves like `exdotsf program < input`.
+*/
+#define DOTSF_SERVE_MAGIC "DSF1"
+#define DOTSF_SERVE_MAX_SOURCE (64u << 20)
+#define DOTSF_SERVE_BACKOFF_MS 50 //how long a worker waits before accepting again when the process is out of file descriptors.
+typedef struct {
+    char magic[4];
+    uint32_t flags; //reserved, 0.
+    uint64_t srclen, inlen;
+} dotsf_serve_request;
+typedef struct {
+    uint64_t hash, used; //used is when it was last asked for, the idle entry with the lowest goes first.
+    char* src;
+    size_t size;
+    dotsf_program* prog;
+    unsigned int refs; //requests running it right now, an entry is only replaced while this is 0.
+} dotsf_serve_entry;
+typedef struct {
+    int listenfd;
+    unsigned int flags; //dotsf_load's, from the command line.
+    dotsf_engine engine;
+    pthread_mutex_t lock; //guards everything below.
+    dotsf_serve_entry* entries; //allocated once with room for cap, so an entry never moves while it is in use.
+    size_t count, cap;
+    uint64_t tick;
+} dotsf_server;
+typedef struct {
+    int fd;
+    uint64_t inleft; //input of the current request not read yet.
+    bool broken; //the client went away, the rest of the run's output is thrown away.
+} dotsf_serve_conn;
+bool _dotsf_recv_all(int fd, void* buf, size_t size)
+{
+    for (char* p = buf; size > 0; )
+    {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR){continue;}
+        if (n <= 0){return false;}
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+bool _dotsf_send_all(int fd, const void* buf, size_t size)
+{
+    for (const char* p = buf; size > 0; )
+    {
+        ssize_t n = send(fd, p, size, 0);
+        if (n < 0 && errno == EINTR){continue;}
+        if (n <= 0){return false;}
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+ptrdiff_t _dotsf_serve_read(void* ctx, void* buf, size_t size)
+{
+    dotsf_serve_conn* conn = ctx;
+    if (conn->inleft == 0 || conn->broken){return 0;}
+    if (size > conn->inleft){size = conn->inleft;}
+    ssize_t n;
+    do {n = recv(conn->fd, buf, size, 0);} while (n < 0 && errno == EINTR);
+    if (n <= 0){conn->broken = true; return 0;}
+    conn->inleft -= n;
+    return n;
+}
+ptrdiff_t _dotsf_serve_write(void* ctx, const void* buf, size_t size) //one frame per block the interpreter flushes.
+{
+    dotsf_serve_conn* conn = ctx;
+    uint32_t len = size;
+    if (conn->broken || size == 0){return (conn->broken) ? (-1) : (0);}
+    if (!_dotsf_send_all(conn->fd, &len, sizeof(len)) || !_dotsf_send_all(conn->fd, buf, size)){conn->broken = true; return -1;}
+    return size;
+}
+dotsf_serve_entry* _dotsf_serve_find(dotsf_server* server, const char* src, size_t size, uint64_t hash) //call with server->lock held.
+{
+    for (size_t i = 0; i < server->count; i++)
+    {
+        dotsf_serve_entry* entry = server->entries+i;
+        if (entry->hash == hash && entry->size == size && memcmp(entry->src, src, size) == 0){return entry;}
+    }
+    return NULL;
+}
+//the program for src from the cache, loaded and added to it if it isn't there. *entry is NULL when every slot was busy,
+//then the caller owns the program. returns 0 or dotsf_load's status.
+int _dotsf_serve_acquire(dotsf_server* server, char** src, size_t size, dotsf_program** prog, dotsf_serve_entry** entry)
+{
+    uint64_t hash = _dotsf_hash(*src, size);
+    pthread_mutex_lock(&server->lock);
+    if ((*entry = _dotsf_serve_find(server, *src, size, hash)) != NULL)
+    {
+        (*entry)->refs++;
+        (*entry)->used = ++server->tick;
+        *prog = (*entry)->prog;
+        pthread_mutex_unlock(&server->lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&server->lock);
+    //loaded without the lock, another thread may load the same program meanwhile, the first to finish gets the slot.
+    int status = dotsf_load(prog, *src, server->flags, NULL);
+    if (status != 0){return status;}
+    pthread_mutex_lock(&server->lock);
+    dotsf_serve_entry* slot = _dotsf_serve_find(server, *src, size, hash);
+    if (slot != NULL){dotsf_unload(*prog); *prog = slot->prog;}
+    else if (server->count < server->cap){slot = server->entries+server->count++;}
+    else
+    {
+        for (size_t i = 0; i < server->count; i++)
+        {
+            dotsf_serve_entry* old = server->entries+i;
+            if (old->refs == 0 && (slot == NULL || old->used < slot->used)){slot = old;}
+        }
+        if (slot != NULL){free(slot->src); dotsf_unload(slot->prog); *slot = (dotsf_serve_entry){ };}
+    }
+    if (slot != NULL && slot->prog == NULL) //a new entry takes over src.
+    {
+        *slot = (dotsf_serve_entry){.hash=hash, .src=*src, .size=size, .prog=*prog};
+        *src = NULL;
+    }
+    if (slot != NULL){slot->refs++; slot->used = ++server->tick;}
+    *entry = slot;
+    pthread_mutex_unlock(&server->lock);
+    return 0;
+}
+void _dotsf_serve_release(dotsf_server* server, dotsf_program* prog, dotsf_serve_entry* entry)
+{
+    if (entry == NULL){dotsf_unload(prog); return;}
+    pthread_mutex_lock(&server->lock);
+    entry->refs--;
+    pthread_mutex_unlock(&server->lock);
+}
+bool _dotsf_serve_request(dotsf_server* server, dotsf_interpreter* interp, int fd) //false once the connection should be closed.
+{
+    dotsf_serve_request req;
+    dotsf_serve_conn conn = {.fd=fd};
+    dotsf_io io = {.read=_dotsf_serve_read, .write=_dotsf_serve_write, .ctx=&conn};
+    if (!_dotsf_recv_all(fd, &req, sizeof(req))){return false;}
+    if (memcmp(req.magic, DOTSF_SERVE_MAGIC, 4) != 0 || req.srclen > DOTSF_SERVE_MAX_SOURCE){return false;}
+    char* src = malloc(req.srclen+1);
+    if (src == NULL || !_dotsf_recv_all(fd, src, req.srclen)){free(src); return false;}
+    src[req.srclen] = 0;
+    dotsf_program* prog;
+    dotsf_serve_entry* entry;
+    int status = _dotsf_serve_acquire(server, &src, req.srclen, &prog, &entry);
+    conn.inleft = req.inlen;
+    if (status == 0)
+    {
+        dotsf_set_io(interp, &io);
+        status = dotsf_run(interp, prog);
+        _dotsf_serve_release(server, prog, entry);
+    }
+    free(src);
+    char skip[4096]; //whatever input the program didn't read, so the next request starts where it should.
+    while (conn.inleft > 0 && _dotsf_serve_read(&conn, skip, sizeof(skip)) > 0){}
+    uint32_t end = 0;
+    int32_t result = status;
+    return !conn.broken && _dotsf_send_all(fd, &end, sizeof(end)) && _dotsf_send_all(fd, &result, sizeof(result));
+}
+void* _dotsf_serve_worker(void* arg)
+{
+    dotsf_server* server = arg;
+    dotsf_interpreter* interp = dotsf_create(NULL);
+    if (interp == NULL){return NULL;}
+    dotsf_set_engine(interp, server->engine);
+    for (;;)
+    {
+        int fd = accept(server->listenfd, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED){continue;}
+            //the pending connection stays queued until a descriptor is closed, accepting again right away would only spin.
+            if (errno == EMFILE || errno == ENFILE){poll(NULL, 0, DOTSF_SERVE_BACKOFF_MS); continue;}
+            break;
+        }
+        while (_dotsf_serve_request(server, interp, fd)){}
+        close(fd);
+    }
+    dotsf_destroy(interp);
+    return NULL;
+}
+int _dotsf_serve(const char* path, unsigned int flags, dotsf_engine engine, unsigned int nworkers, size_t cachesize) //only returns on errors.
+{
+    dotsf_server server = {.flags=flags, .engine=engine, .cap=(cachesize > 0) ? (cachesize) : (1)};
+    struct sockaddr_un addr = {.sun_family=AF_UNIX};
+    struct stat st;
+    if (strlen(path) >= sizeof(addr.sun_path)){printf("ERROR: Socket path %s is too long\n", path); return -555;}
+    signal(SIGPIPE, SIG_IGN); //a client that hangs up only ends its own connection.
+    strcpy(addr.sun_path, path);
+    if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)){unlink(path);} //left behind by an earlier server.
+    server.listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server.listenfd < 0 || bind(server.listenfd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(server.listenfd, 64) != 0)
+    {
+        printf("ERROR: Could not listen on %s: %s\n", path, strerror(errno));
+        if (server.listenfd >= 0){close(server.listenfd);}
+        return -669;
+    }
+    if ((server.entries = calloc(server.cap, sizeof(dotsf_serve_entry))) == NULL){close(server.listenfd); return -400;}
+    pthread_mutex_init(&server.lock, NULL);
+    if (nworkers < 1){nworkers = 1;}
+    for (unsigned int w = 1; w < nworkers; w++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, _dotsf_serve_worker, &server) != 0){break;}
+        pthread_detach(thread);
+    }
+    _dotsf_serve_worker(&server); //only returns if accept fails for good, the other workers then fail the same way.
+    printf("ERROR: Could not accept connections on %s: %s\n", path, strerror(errno));
+    return -669;
+}
+#endif
 
-dotsf_interpreter INTERP = { };
+#ifndef DOTSF_NO_MAIN //defined by programs that use this file as a library, such as the output of --emit-c.
+#if DOTSF_HAVE_TRACE && defined(SIGUSR1)
+static const dotsf_trace* _dotsf_signal_trace; //what SIGUSR1 writes out and where, set by main while a traced program runs.
+static const char* _dotsf_signal_trace_path;
+void _dotsf_trace_on_signal(int sig)
+{
+    int saved = errno;
+    (void)sig;
+    if (_dotsf_signal_trace != NULL){dotsf_trace_save(_dotsf_signal_trace, 0, _dotsf_signal_trace_path);}
+    errno = saved;
+}
+#endif
 int main(int argc, char** argv)
 {
-
-    char* program_src = NULL;
-    FILE* fp = NULL;
-    size_t fsize = 0;
-    if (argc < 2){puts("ERROR: At least 1 command line argument is required."); return -555;}
-    fp = fopen(argv[1], "rb");
-    if (fp == NULL){printf("ERROR: No file named %s\n", argv[1]); return -666;}
-    fseek(fp, 0, SEEK_END);
-    fsize = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-    program_src = calloc(fsize+1, 1);
-    fread(program_src, 1, fsize, fp);
-    fclose(fp);
-
-    int res = dotsf_exec(&INTERP, program_src);
+    dotsf_source source;
+    dotsf_program* prog;
+    dotsf_interpreter* interp;
+    dotsf_engine engine = DOTSF_ENGINE_AUTO;
+    const char* path = NULL;
+    char* cachepath = NULL;
+    bool cache = false;
+    size_t trace = 0; //ring buffer entries, 0 when not tracing.
+    const char* tracepath = "exdotsf.trace";
+    size_t erroff = 0;
+    uint64_t preeval = 0; //the --preeval budget, 0 when not given.
+    bool mapstdin = false, emitc = false, optimize = true, dump = false, profile = false, loadstats = false, linebuffered = isatty(STDOUT_FILENO);
+    dotsf_load_stats stats = { };
+    #if DOTSF_HAVE_BATCH
+    bool batch = false;
+    const char* outdir = NULL;
+    size_t ninputs = 0, inputcap = 16;
+    const char** inputs = malloc(sizeof(char*)*inputcap);
+    if (inputs == NULL){return -400;}
+    #endif
+    #if DOTSF_HAVE_BATCH || DOTSF_HAVE_SERVE
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    #if DOTSF_HAVE_SERVE
+    const char* servepath = NULL;
+    long servecache = 64;
+    #endif
+    for (int ai = 1; ai < argc; ai++)
+    {
+        if (strcmp(argv[ai], "--engine=switch") == 0){engine = DOTSF_ENGINE_SWITCH;}
+        else if (strcmp(argv[ai], "--engine=threaded") == 0){engine = DOTSF_ENGINE_THREADED;}
+        else if (strcmp(argv[ai], "--jit") == 0){engine = DOTSF_ENGINE_JIT;}
+        else if (strcmp(argv[ai], "--emit-c") == 0){emitc = true;}
+        else if (strcmp(argv[ai], "--no-opt") == 0){optimize = false;}
+        else if (strcmp(argv[ai], "--dump") == 0){dump = true;}
+        else if (strcmp(argv[ai], "--load-stats") == 0){loadstats = true;}
+        else if (strcmp(argv[ai], "--preeval") == 0){preeval = DOTSF_PREEVAL_STEPS;}
+        else if (strncmp(argv[ai], "--preeval=", 10) == 0){preeval = (strtoull(argv[ai]+10, NULL, 10) > 0) ? (strtoull(argv[ai]+10, NULL, 10)) : (1);}
+        else if (strcmp(argv[ai], "--profile") == 0 && DOTSF_HAVE_PROFILE){profile = true;}
+        else if (strcmp(argv[ai], "--trace") == 0 && DOTSF_HAVE_TRACE){trace = 4096;}
+        else if (strncmp(argv[ai], "--trace=", 8) == 0 && DOTSF_HAVE_TRACE){trace = (atol(argv[ai]+8) > 0) ? (atol(argv[ai]+8)) : (1);}
+        else if (strncmp(argv[ai], "--trace-file=", 13) == 0 && DOTSF_HAVE_TRACE){tracepath = argv[ai]+13;}
+        else if (strcmp(argv[ai], "--line-buffered") == 0){linebuffered = true;}
+        else if (strcmp(argv[ai], "--mmap-stdin") == 0){mapstdin = true;}
+        #if DOTSF_HAVE_MMAP
+        else if (strcmp(argv[ai], "--cache") == 0){cache = true;}
+        else if (strncmp(argv[ai], "--cache=", 8) == 0){cache = true; cachepath = argv[ai]+8;}
+        #endif
+        #if DOTSF_HAVE_BATCH || DOTSF_HAVE_SERVE
+        else if (strncmp(argv[ai], "--jobs=", 7) == 0){jobs = atol(argv[ai]+7);}
+        #endif
+        #if DOTSF_HAVE_SERVE
+        else if (strcmp(argv[ai], "--serve") == 0 && ai+1 < argc){servepath = argv[++ai];}
+        else if (strncmp(argv[ai], "--serve-cache=", 14) == 0){servecache = atol(argv[ai]+14);}
+        #endif
+        #if DOTSF_HAVE_BATCH
+        else if (strcmp(argv[ai], "--batch") == 0){batch = true;}
+        else if (strncmp(argv[ai], "--out-dir=", 10) == 0){outdir = argv[ai]+10;}
+        else if (strncmp(argv[ai], "--inputs=", 9) == 0)
+        {
+            if (!_dotsf_batch_list(argv[ai]+9, &inputs, &ninputs, &inputcap)){printf("ERROR: Could not read %s\n", argv[ai]+9); return -667;}
+        }
+        else if (path != NULL && strncmp(argv[ai], "--", 2) != 0) //every argument after the program is an input.
+        {
+            if (ninputs == inputcap){inputs = realloc(inputs, sizeof(char*)*(inputcap *= 2));}
+            if (inputs == NULL || (inputs[ninputs++] = strdup(argv[ai])) == NULL){return -400;}
+        }
+        #endif
+        else if (strncmp(argv[ai], "--", 2) == 0){printf("ERROR: Unknown option %s\n", argv[ai]); return -555;}
+        else if (path == NULL){path = argv[ai];}
+    }
+    #if DOTSF_HAVE_SERVE
+    if (servepath != NULL)
+    {
+        if (path != NULL || emitc || dump || profile || trace || cache){puts("ERROR: --serve takes no program and no options but --engine, --jit, --no-opt, --preeval, --jobs and --serve-cache."); return -555;}
+        #if DOTSF_HAVE_BATCH
+        while (ninputs > 0){free((char*)inputs[--ninputs]);}
+        free(inputs);
+        #endif
+        unsigned int flags = ((optimize) ? (0) : (DOTSF_LOAD_NO_OPT))|((engine == DOTSF_ENGINE_JIT) ? (DOTSF_LOAD_JIT) : (0))|((preeval) ? (DOTSF_LOAD_PREEVAL) : (0));
+        return _dotsf_serve(servepath, flags, engine, (jobs > 0) ? ((unsigned int)jobs) : (1), (servecache > 0) ? ((size_t)servecache) : (1));
+    }
+    #endif
+    if (path == NULL){puts("ERROR: At least 1 command line argument is required."); return -555;}
+    #if DOTSF_HAVE_BATCH
+    if (batch && profile){puts("ERROR: --profile can't be used with --batch."); return -555;}
+    if (batch && trace){puts("ERROR: --trace can't be used with --batch."); return -555;}
+    const char *clash1, *clash2;
+    if (batch && outdir != NULL && _dotsf_batch_clash(inputs, ninputs, &clash1, &clash2))
+    {
+        printf("ERROR: --out-dir would write the output of both %s and %s to %s/%s.out\n", clash1, clash2, outdir, _dotsf_batch_name(clash1));
+        return -555;
+    }
+    #endif
+    if (profile && trace){puts("ERROR: --trace can't be used with --profile."); return -555;}
+    //--emit-c and --profile work on the program as written.
+    unsigned int flags = (emitc || profile || !optimize) ? (DOTSF_LOAD_NO_OPT) : (0);
+    if (engine == DOTSF_ENGINE_JIT && !emitc && !profile && !trace){flags |= DOTSF_LOAD_JIT;} //the tracing engine only interprets.
+    if (preeval && !emitc && !profile && !trace){flags |= DOTSF_LOAD_PREEVAL;} //and those three are about every step the program takes.
+    int res;
+    #if DOTSF_HAVE_MMAP
+    //--dump and --profile need the source anyway and --emit-c only runs once, so the cache only serves plain runs.
+    if (cache && !emitc && !dump && !profile && strcmp(path, "-") != 0)
+    {
+        char* defpath = NULL;
+        if (cachepath == NULL && (cachepath = defpath = malloc(strlen(path)+7)) != NULL){sprintf(defpath, "%s.cache", path);}
+        res = (cachepath != NULL) ? (_dotsf_load_cached(&prog, &source, path, cachepath, flags, &erroff, (loadstats) ? (&stats) : (NULL), preeval)) : (-667);
+        free(defpath);
+    }
+    else
+    #endif
+    {
+        res = dotsf_load_source(&source, path);
+        if (res == 0){res = _dotsf_load(&prog, source.text, flags, &erroff, (loadstats) ? (&stats) : (NULL), preeval);}
+    }
+    if (res == -666 && source.text == NULL){printf("ERROR: No file named %s\n", path); return res;}
+    else if (res < 0 && source.text == NULL){printf("ERROR: Could not read %s\n", path); return res;}
+    else if (res < 0)
+    {
+        size_t line, col;
+        _dotsf_line_col(source.text, erroff, &line, &col);
+        printf("\nError Status %i\n", res);
+        fflush(stdout);
+        fprintf(stderr, "(while loading %s, at line %zu, column %zu)\n", path, line, col);
+        return res;
+    }
+    if (loadstats && stats.loaded)
+    {
+        fprintf(stderr, "%zu bytes into %zu instructions: compiled in %.3fs (%.2f GB/s), optimized in %.3fs\n",
+            stats.bytes, prog->len, stats.compile/1e9, (stats.compile > 0) ? (stats.bytes/(double)stats.compile) : (0), stats.optimize/1e9);
+        if (flags & DOTSF_LOAD_PREEVAL)
+        {
+            if (prog->snap != NULL){fprintf(stderr, "preevaluated up to instruction %u in %.3fs\n", (unsigned)prog->snap->start, stats.preeval/1e9);}
+            else {fprintf(stderr, "nothing preevaluated (%.3fs)\n", stats.preeval/1e9);}
+        }
+    }
+    else if (loadstats){fputs("(loaded from the cache, nothing was compiled)\n", stderr);}
+    if (emitc || dump)
+    {
+        if (emitc){res = (dotsf_emit_c(prog, stdout) && fflush(stdout) == 0) ? (0) : (-668);}
+        else {dotsf_dump_program(prog, source.text, stdout);}
+        dotsf_unload(prog);
+        dotsf_free_source(&source);
+        return res;
+    }
+    #if DOTSF_HAVE_BATCH
+    if (batch)
+    {
+        dotsf_free_source(&source);
+        res = _dotsf_run_batch(prog, engine, inputs, ninputs, outdir, (jobs > 0) ? ((unsigned int)jobs) : (1));
+        dotsf_unload(prog);
+    }
+    while (ninputs > 0){free((char*)inputs[--ninputs]);}
+    free(inputs);
+    if (batch){return res;}
+    #endif
+    if ((interp = dotsf_create(NULL)) == NULL){printf("\nError Status -400\n"); return -400;}
+    dotsf_set_engine(interp, engine);
+    dotsf_set_line_buffered(interp, linebuffered);
+    if (!profile){dotsf_free_source(&source);} //the profile report needs it for line numbers.
+    if (mapstdin){_dotsf_map_stdin(interp);}
+    #if DOTSF_HAVE_PROFILE
+    dotsf_profile prof;
+    if (profile && dotsf_profile_init(&prof, prog)){interp->profile = &prof;}
+    uint64_t started = _dotsf_now_ns();
+    #endif
+    #if DOTSF_HAVE_TRACE
+    dotsf_trace ring;
+    if (trace && dotsf_trace_init(&ring, trace)){interp->trace = &ring;}
+    #ifdef SIGUSR1
+    _dotsf_signal_trace = interp->trace;
+    _dotsf_signal_trace_path = tracepath;
+    if (interp->trace != NULL){signal(SIGUSR1, _dotsf_trace_on_signal);}
+    #endif
+    #endif
+    res = dotsf_run(interp, prog);
+    #if DOTSF_HAVE_PROFILE
+    if (interp->profile != NULL)
+    {
+        dotsf_profile_report(&prof, prog, source.text, (_dotsf_now_ns()-started)/1e9, stderr);
+        dotsf_profile_free(&prof);
+        interp->profile = NULL;
+    }
+    #endif
+    #if DOTSF_HAVE_TRACE
+    if (interp->trace != NULL)
+    {
+        #ifdef SIGUSR1
+        signal(SIGUSR1, SIG_DFL);
+        _dotsf_signal_trace = NULL;
+        #endif
+        if (res < 0 && dotsf_trace_save(&ring, res, tracepath)){fprintf(stderr, "(the last %zu steps were written to %s)\n", (size_t)((ring.steps < ring.mask) ? (ring.steps) : (ring.mask)), tracepath);}
+        dotsf_trace_free(&ring);
+        interp->trace = NULL;
+    }
+    #else
+    (void)tracepath;
+    #endif
+    dotsf_destroy(interp);
+    dotsf_free_source(&source);
+    dotsf_unload(prog);
     if (res < 0){printf("\nError Status %i\n", res); return res;}
     return res;
-}
\ No newline at end of file
+}
+#endif
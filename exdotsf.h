@@ -0,0 +1,59 @@
+/*
+    EXDotSF as a library. exdotsf.c is both the implementation and the command line interpreter,
+    build it with -DDOTSF_NO_MAIN (or `make libexdotsf.a`) to leave main out. Same license as exdotsf.c.
+
+    dotsf_interpreter* interp = dotsf_create(&io); //io is where the program's input comes from and its output goes.
+    dotsf_program* prog;
+    size_t erroff;
+    int status = dotsf_load(&prog, src, 0, &erroff); //negative if src doesn't compile, erroff is where.
+    if (status == 0){status = dotsf_run(interp, prog);} //negative if the program failed, the same Error Status exdotsf prints.
+    dotsf_unload(prog);
+    dotsf_destroy(interp);
+
+    Nothing here uses global state: an interpreter runs one program at a time, but any number of interpreters can exist
+    and run on different threads at once, and a loaded program is never written to again, so they can all share it.
+    A program can't bring the host down either: dividing by 0 (or INT_MIN by -1) with / makes dotsf_run return -133, it never raises SIGFPE.
+*/
+#ifndef EXDOTSF_H
+#define EXDOTSF_H
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+typedef int dotsf_int;
+typedef enum {
+    DOTSF_ENGINE_AUTO, //the fastest engine this build has.
+    DOTSF_ENGINE_SWITCH, //portable switch dispatch.
+    DOTSF_ENGINE_THREADED, //computed goto dispatch, falls back to DOTSF_ENGINE_SWITCH where unavailable.
+    DOTSF_ENGINE_JIT //native code from dotsf_jit_compile, falls back to DOTSF_ENGINE_THREADED for programs that weren't compiled.
+} dotsf_engine;
+typedef struct dotsf_interpreter dotsf_interpreter;
+typedef struct dotsf_program dotsf_program;
+typedef struct {
+    //reads up to size bytes of input into buf, returns how many, 0 at the end of the input or <0 on an error (both read as EOF).
+    ptrdiff_t (*read)(void* ctx, void* buf, size_t size);
+    //takes up to size bytes of output from buf, returns how many were taken, <= 0 throws the rest of this block away.
+    ptrdiff_t (*write)(void* ctx, const void* buf, size_t size);
+    void* ctx; //passed to both.
+} dotsf_io;
+#define DOTSF_LOAD_NO_OPT 1 //run the program exactly as parsed, like --no-opt.
+#define DOTSF_LOAD_JIT 2 //compile it to native code where the JIT is available, like --jit.
+#define DOTSF_LOAD_PREEVAL 4 //run it up to its first I/O now and start every run from there, like --preeval.
+
+dotsf_interpreter* dotsf_create(const dotsf_io* io); //NULL io means stdin and stdout. returns NULL when out of memory.
+void dotsf_destroy(dotsf_interpreter* interp);
+void dotsf_set_io(dotsf_interpreter* interp, const dotsf_io* io); //between runs only, drops whatever input was read ahead.
+void dotsf_set_engine(dotsf_interpreter* interp, dotsf_engine engine);
+void dotsf_set_line_buffered(dotsf_interpreter* interp, bool linebuffered); //write after every newline instead of in 64 KiB blocks.
+int dotsf_load(dotsf_program** out, const char* src, unsigned int flags, size_t* erroff); //src is NUL terminated, erroff may be NULL.
+void dotsf_unload(dotsf_program* prog);
+int dotsf_run(dotsf_interpreter* interp, const dotsf_program* prog); //every run starts from an empty stack 0, or where DOTSF_LOAD_PREEVAL stopped.
+int dotsf_exec(dotsf_interpreter* interp, const char* src); //loads, runs and unloads src.
+void dotsf_dump_program(const dotsf_program* prog, const char* src, FILE* out); //what --dump prints.
+bool dotsf_emit_c(const dotsf_program* prog, FILE* out); //what --emit-c prints.
+#ifdef __cplusplus
+}
+#endif
+#endif
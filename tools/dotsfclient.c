@@ -0,0 +1,144 @@
+/*
+    dotsfclient, runs a program on an exdotsf --serve server as if it were `exdotsf program < input`, e.g.
+
+        exdotsf --serve /tmp/dotsf.sock &
+        dotsfclient /tmp/dotsf.sock program.dsf < input
+
+    The program's output goes to stdout and a program that fails prints Error Status and exits with it, like exdotsf.
+    -r N sends the same request N times over one connection and prints the time per request to stderr,
+    which is what a warm server costs compared to starting exdotsf.
+
+    Same license as exdotsf.c.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+//has to match dotsf_serve_request in exdotsf.c.
+typedef struct client_request
+{
+    char magic[4];
+    uint32_t flags;
+    uint64_t srclen, inlen;
+} client_request;
+
+char* client_slurp(FILE* in, size_t* size) //the whole stream, NULL if it can't be read.
+{
+    size_t cap = 4096, len = 0, n;
+    char* data = malloc(cap);
+    if (data == NULL){return NULL;}
+    while ((n = fread(data+len, 1, cap-len, in)) > 0)
+    {
+        len += n;
+        if (len == cap){char* grown = realloc(data, cap *= 2); if (grown == NULL){free(data); return NULL;} data = grown;}
+    }
+    if (ferror(in)){free(data); return NULL;}
+    *size = len;
+    return data;
+}
+bool client_send(int fd, const void* buf, size_t size)
+{
+    for (const char* p = buf; size > 0; )
+    {
+        ssize_t n = send(fd, p, size, 0);
+        if (n < 0 && errno == EINTR){continue;}
+        if (n <= 0){return false;}
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+bool client_recv(int fd, void* buf, size_t size)
+{
+    for (char* p = buf; size > 0; )
+    {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR){continue;}
+        if (n <= 0){return false;}
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+bool client_frame(int fd, bool print, int32_t* status, bool* done) //reads one output frame, or the status that ends the response.
+{
+    //the server always sends a frame whole, so once its length is there the rest follows without waiting on the input.
+    char buf[65536];
+    uint32_t len;
+    if (!client_recv(fd, &len, sizeof(len))){return false;}
+    if (len == 0){*done = true; return client_recv(fd, status, sizeof(*status));}
+    while (len > 0)
+    {
+        uint32_t part = (len < sizeof(buf)) ? (len) : (sizeof(buf));
+        if (!client_recv(fd, buf, part)){return false;}
+        if (print){fwrite(buf, 1, part, stdout);}
+        len -= part;
+    }
+    return true;
+}
+bool client_run(int fd, const char* src, size_t srclen, const char* input, size_t inlen, bool print, int32_t* status)
+{
+    client_request req = {.magic={'D', 'S', 'F', '1'}, .srclen=srclen, .inlen=inlen};
+    bool done = false;
+    if (!client_send(fd, &req, sizeof(req)) || !client_send(fd, src, srclen)){return false;}
+    /*
+        The server runs the program while its input is still arriving and sends output as it goes, so the input is only
+        sent as far as the socket takes it without blocking and output is read in between. Otherwise a program that echoes
+        a large input would leave both ends blocked on full buffers.
+    */
+    while (inlen > 0)
+    {
+        struct pollfd pfd = {.fd=fd, .events=POLLIN|POLLOUT};
+        if (poll(&pfd, 1, -1) < 0){if (errno == EINTR){continue;} return false;}
+        if (pfd.revents & POLLIN){if (!client_frame(fd, print, status, &done) || done){return false;} continue;} //the status only comes after all the input.
+        if (!(pfd.revents & POLLOUT)){return false;}
+        ssize_t n = send(fd, input, inlen, MSG_DONTWAIT);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)){continue;}
+        if (n <= 0){return false;}
+        input += n;
+        inlen -= n;
+    }
+    while (!done){if (!client_frame(fd, print, status, &done)){return false;}}
+    return true;
+}
+int main(int argc, char** argv)
+{
+    int repeat = 1, argi = 1;
+    if (argc > 2 && !strcmp(argv[1], "-r")){repeat = atoi(argv[2]); argi = 3;}
+    if (argc-argi != 2 || repeat < 1){fprintf(stderr, "usage: %s [-r repeat] socket program.dsf < input\n", argv[0]); return 1;}
+    FILE* progfile = fopen(argv[argi+1], "rb");
+    size_t srclen, inlen;
+    char* src = (progfile != NULL) ? (client_slurp(progfile, &srclen)) : (NULL);
+    char* input = client_slurp(stdin, &inlen);
+    if (progfile != NULL){fclose(progfile);}
+    if (src == NULL){printf("ERROR: No file named %s\n", argv[argi+1]); return -666;}
+    if (input == NULL){fprintf(stderr, "could not read stdin\n"); return 1;}
+
+    struct sockaddr_un addr = {.sun_family=AF_UNIX};
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    strncpy(addr.sun_path, argv[argi], sizeof(addr.sun_path)-1);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){fprintf(stderr, "could not connect to %s: %s\n", argv[argi], strerror(errno)); return 1;}
+    int32_t status = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < repeat; r++)
+    {
+        if (!client_run(fd, src, srclen, input, inlen, r == repeat-1, &status)){fprintf(stderr, "lost the connection to %s\n", argv[argi]); return 1;}
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (repeat > 1){fprintf(stderr, "%.1f us per request\n", ((end.tv_sec-start.tv_sec)*1e9+(end.tv_nsec-start.tv_nsec))/1e3/repeat);}
+    close(fd);
+    free(src);
+    free(input);
+    fflush(stdout);
+    if (status < 0){printf("\nError Status %i\n", (int)status);}
+    return status;
+}
@@ -0,0 +1,127 @@
+/*
+    dotsftrace, prints the execution traces exdotsf --trace writes, e.g.
+
+        dotsftrace exdotsf.trace
+        dotsftrace -n 20 -s program.dsf exdotsf.trace
+
+    One line per step, oldest first: the step number, the instruction, its opcode, the stack it ran on and what was on top
+    of that stack before it ran. With -s the program the trace came from is used to turn source offsets into line:col and
+    the character there, -n only prints the last N steps.
+    The file has to come from a machine with the same byte order, the opcode names are read from the file itself.
+
+    Same license as exdotsf.c.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define TRACE_MAGIC "EXDotSFt"
+#define TRACE_VERSION 1
+#define TRACE_NAME_SIZE 8
+
+//these two have to match dotsf_trace_header and dotsf_trace_entry in exdotsf.c.
+typedef struct trace_header
+{
+    char magic[8];
+    uint32_t version, entrysize, opcount, count;
+    uint64_t steps;
+    int32_t status;
+    uint32_t pad;
+} trace_header;
+typedef struct trace_entry
+{
+    uint32_t pc, srcoff;
+    int32_t top;
+    uint8_t op, stack, empty, pad;
+} trace_entry;
+
+char* trace_slurp(const char* path, size_t* size) //the whole file, NULL if it can't be read.
+{
+    FILE* in = fopen(path, "rb");
+    size_t cap = 4096, len = 0, n;
+    char* data = malloc(cap+1);
+    if (in == NULL || data == NULL){if (in != NULL){fclose(in);} free(data); return NULL;}
+    while ((n = fread(data+len, 1, cap-len, in)) > 0)
+    {
+        len += n;
+        if (len == cap){char* grown = realloc(data, (cap *= 2)+1); if (grown == NULL){break;} data = grown;}
+    }
+    fclose(in);
+    data[len] = 0;
+    *size = len;
+    return data;
+}
+void trace_line_col(const char* src, size_t size, size_t off, size_t* line, size_t* col)
+{
+    *line = 1;
+    *col = 1;
+    for (size_t i = 0; i < off && i < size; i++){if (src[i] == '\n'){(*line)++; *col = 1;} else {(*col)++;}}
+}
+void trace_usage(const char* self)
+{
+    fprintf(stderr, "usage: %s [-n last] [-s program.dsf] exdotsf.trace\n", self);
+}
+int main(int argc, char** argv)
+{
+    const char *path = NULL, *srcpath = NULL;
+    uint64_t last = UINT64_MAX;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n") && i+1 < argc){last = strtoull(argv[++i], NULL, 10);}
+        else if (!strcmp(argv[i], "-s") && i+1 < argc){srcpath = argv[++i];}
+        else if (argv[i][0] == '-' || path != NULL){trace_usage(argv[0]); return 1;}
+        else {path = argv[i];}
+    }
+    if (path == NULL){trace_usage(argv[0]); return 1;}
+    size_t size, srcsize = 0;
+    char* data = trace_slurp(path, &size);
+    char* src = (srcpath != NULL) ? (trace_slurp(srcpath, &srcsize)) : (NULL);
+    if (data == NULL){fprintf(stderr, "could not read %s\n", path); return 1;}
+    if (srcpath != NULL && src == NULL){fprintf(stderr, "could not read %s\n", srcpath); return 1;}
+
+    trace_header header;
+    if (size < sizeof(header)){fprintf(stderr, "%s is not an exdotsf trace\n", path); return 1;}
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, TRACE_MAGIC, 8) != 0 || header.version != TRACE_VERSION || header.entrysize != sizeof(trace_entry))
+    {
+        fprintf(stderr, "%s is not an exdotsf trace this dotsftrace can read\n", path);
+        return 1;
+    }
+    const char* names = data+sizeof(header);
+    const char* entries = names+(size_t)header.opcount*TRACE_NAME_SIZE;
+    if ((size-sizeof(header))/TRACE_NAME_SIZE < header.opcount || (size_t)(data+size-entries)/sizeof(trace_entry) < header.count)
+    {
+        fprintf(stderr, "%s is truncated\n", path);
+        return 1;
+    }
+
+    printf("%" PRIu64 " steps recorded, the last %" PRIu32 " kept", header.steps, header.count);
+    if (header.status != 0){printf(", the program failed with Error Status %" PRIi32 "\n", header.status);}
+    else {printf(", written while the program was running\n");}
+    printf("%14s %7s  %-10s %-8s %5s %11s\n", "step", "pc", (src != NULL) ? ("line:col") : ("offset"), "op", "stack", "top");
+    uint64_t skip = (last < header.count) ? (header.count-last) : (0);
+    for (uint64_t i = skip; i < header.count; i++)
+    {
+        trace_entry e;
+        char at[48], name[TRACE_NAME_SIZE+1] = "?";
+        memcpy(&e, entries+i*sizeof(trace_entry), sizeof(e));
+        if (e.op < header.opcount){memcpy(name, names+(size_t)e.op*TRACE_NAME_SIZE, TRACE_NAME_SIZE); name[TRACE_NAME_SIZE] = 0;}
+        if (src != NULL)
+        {
+            size_t line, col;
+            trace_line_col(src, srcsize, e.srcoff, &line, &col);
+            char c = (e.srcoff < srcsize && src[e.srcoff] > ' ') ? (src[e.srcoff]) : (' ');
+            snprintf(at, sizeof(at), "%zu:%zu %c", line, col, c);
+        }
+        else {snprintf(at, sizeof(at), "%" PRIu32, e.srcoff);}
+        printf("%14" PRIu64 " %7" PRIu32 "  %-10s %-8s %5u ", header.steps-header.count+i, e.pc, at, name, (unsigned)e.stack);
+        if (e.empty){printf("%11s\n", "(empty)");}
+        else {printf("%11" PRIi32 "\n", e.top);}
+    }
+    free(src);
+    free(data);
+    return 0;
+}